@@ -84,6 +84,8 @@ void showGreeting(void)
 //============================================================
 void showHelp(void)
 {
+	cout << "Type 'perft <depth> [divide] [threads N] [hash MB]' to count leaf nodes of current position "
+	     << "(divide shows counts for each move, threads and hash speed up counting)" << endl;
 	cout << "You can set search options with 'set' command. There are following: " << endl;
 	for (const auto&[name, opt] : optionInfos)
 		cout << name << " (min " << opt.minValue << ", max " << opt.maxValue
@@ -99,6 +101,9 @@ void showOptions(void)
 	cout << "Depth: " << (int)opts.depth << endl;
 	cout << "Thread count: " << opts.threadCount << endl;
 	cout << "Time limit: " << opts.timeLimit << "ms" << endl;
+	cout << "SMP mode: " << (opts.smpMode == SMPMode::YBWC ? "YBWC" : "Lazy") << endl;
+	cout << "SMP depth skipping: " << (opts.smpDepthSkipping ? "on" : "off") << endl;
+	cout << "NUMA pinning: " << (opts.numaPinning ? "on" : "off") << endl;
 }
 
 //============================================================
@@ -139,6 +144,10 @@ void endSearch(void)
 			<< chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count()
 			<< " ms to depth " << (int)results.resDepth << ". The score is " << results.score << ". "
 			<< ttFreeEntries << " free slots in TT. " << stats.ttHits << " hits made." << endl;
+		if constexpr (CUTOFFS_COUNT_ENABLED)
+			if (stats.betaCutoffs > 0)
+				cout << stats.betaCutoffs << " beta-cutoffs, " << 100.0 * stats.firstMoveCutoffs
+				     / stats.betaCutoffs << "% of them on the first move." << endl;
 	}
 	catch (const std::runtime_error& err)
 	{
@@ -209,6 +218,60 @@ void loadGame(const std::string& filepath)
 	in.close();
 }
 
+//============================================================
+// Run perft on current position and show its speed. Arguments are
+// tokens of 'perft <depth> [divide] [threads N] [hash MB]' command. If
+// divide is present, leaf count of each root move is shown separately
+//============================================================
+void runPerft(const vector<string>& tokens)
+{
+	int depth, threadCount = 1;
+	long long hashSizeMB = 0;
+	bool divide = false;
+	istringstream iss(tokens[1]);
+	if (!(iss >> depth) || depth < 0 || depth > SEARCH_DEPTH_MAX)
+	{
+		cout << "Error: invalid perft depth " << tokens[1] << endl;
+		return;
+	}
+	for (size_t idx = 2; idx < tokens.size(); ++idx)
+		if (tokens[idx] == "divide")
+			divide = true;
+		else if ((tokens[idx] == "threads" || tokens[idx] == "hash") && idx + 1 < tokens.size())
+		{
+			istringstream argIss(tokens[idx + 1]);
+			if (!(tokens[idx] == "threads" ?
+				argIss >> threadCount && threadCount > 0 && threadCount <= max(Game::getMaxThreadCount(), 1) :
+				argIss >> hashSizeMB && hashSizeMB >= 0 && hashSizeMB <= (long long)PERFT_HASH_SIZE_MAX))
+			{
+				cout << "Error: invalid perft " << tokens[idx] << " argument " << tokens[idx + 1] << endl;
+				return;
+			}
+			++idx;
+		}
+		else
+		{
+			cout << "Error: unrecognized perft argument " << tokens[idx] << endl;
+			return;
+		}
+	uint64_t nodes = 0;
+	const auto st = chrono::high_resolution_clock::now();
+	if (divide || threadCount > 1 || hashSizeMB > 0)
+		for (const auto& [move, moveNodes] : threadCount > 1 || hashSizeMB > 0 ?
+			game.parallelPerftDivide(depth, threadCount, hashSizeMB) : game.perftDivide<true>(depth))
+		{
+			if (divide)
+				cout << move.toAN() << ": " << moveNodes << endl;
+			nodes += moveNodes;
+		}
+	else
+		nodes = game.perft<true>(depth);
+	const auto en = chrono::high_resolution_clock::now();
+	const long long us = max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count());
+	cout << "Perft(" << depth << ") is " << nodes << ", counted in " << us / 1000 << " ms ("
+		<< nodes * 1000000 / us << " nodes per second)" << endl;
+}
+
 //============================================================
 // Processing events from console and engine
 // Returns true if the event wasn't quit, false if it was
@@ -241,7 +304,7 @@ bool processEvent(const Event& e)
 			}
 			else if (tokens[0] == "abort")
 			{
-				game.reset();
+				game.newGame();
 				inGame = false;
 				cout << "Game aborted successfully" << endl;
 			}
@@ -297,6 +360,13 @@ bool processEvent(const Event& e)
 				else
 					loadPosition(tokens[1]);
 			}
+			else if (tokens[0] == "perft")
+			{
+				if (tokens.size() == 1)
+					cout << "Error: missing perft depth" << endl;
+				else
+					runPerft(tokens);
+			}
 			else if (tokens[0] == "game")
 			{
 				if (tokens.size() == 1)
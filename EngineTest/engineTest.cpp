@@ -16,12 +16,94 @@ namespace EngineTest
 		TEST_METHOD(Perft)
 		{
 			Position pos;
-			Assert::AreEqual(1, pos.perft(0));
-			Assert::AreEqual(20, pos.perft(1));
-			Assert::AreEqual(400, pos.perft(2));
-			Assert::AreEqual(8902, pos.perft(3));
-			Assert::AreEqual(197281, pos.perft(4));
-			Assert::AreEqual(4865609, pos.perft(5));
+			Assert::AreEqual(uint64_t(1), pos.perft(0));
+			Assert::AreEqual(uint64_t(20), pos.perft(1));
+			Assert::AreEqual(uint64_t(400), pos.perft(2));
+			Assert::AreEqual(uint64_t(8902), pos.perft(3));
+			Assert::AreEqual(uint64_t(197281), pos.perft(4));
+			Assert::AreEqual(uint64_t(4865609), pos.perft(5));
+			// Divided counts sum up to the whole one
+			uint64_t divideSum = 0;
+			for (const auto& [move, nodes] : pos.perftDivide<true>(4))
+				divideSum += nodes;
+			Assert::AreEqual(uint64_t(197281), divideSum);
+		}
+		// Compile-time tables and sliding attacks (with both indexings) agree with straightforward computation
+		TEST_METHOD(Bitboards)
+		{
+			for (const bool usePext : { false, true })
+			{
+				initSliderAttacks(usePext);
+				Assert::IsTrue(verifyBB());
+			}
+			initBB();
+		}
+		// Loaded positions are written back unchanged and give right perft counts
+		TEST_METHOD(FEN)
+		{
+			Position pos;
+			for (const std::string fen : {
+				"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+				"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+				"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+				"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8" })
+			{
+				pos.loadFEN(fen);
+				Assert::AreEqual(fen, pos.getFEN());
+			}
+			pos.loadFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+			Assert::AreEqual(uint64_t(97862), pos.perft<true>(3));
+			pos.loadFEN("8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1");
+			Assert::AreEqual(uint64_t(1440467), pos.perft<true>(6));
+		}
+		// Direct, discovered, en passant, castling and promotion checks are detected
+		TEST_METHOD(GivesCheck)
+		{
+			Position pos;
+			const std::pair<const char*, std::vector<std::pair<const char*, bool>>> cases[] = {
+				{ "4k3/8/3P4/8/8/8/8/4KB2 w - - 0 1", { { "f1b5", true }, { "f1c4", false }, { "d6d7", true } } },
+				{ "4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1", { { "e4c5", true }, { "e4d6", true }, { "e1e2", false }, { "g1f1", false } } },
+				{ "8/8/8/R2pP2k/8/8/8/K7 w - d6 0 1", { { "e5d6", true }, { "e5e6", false } } },
+				{ "5k2/8/8/8/8/8/8/4K2R w K - 0 1", { { "e1g1", true }, { "h1h8", true }, { "e1f1", false } } },
+				{ "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", { { "e1c1", true } } },
+				{ "4k3/8/8/8/8/8/8/4K2R w K - 0 1", { { "e1g1", false } } },
+				{ "1k6/4P3/8/8/8/8/8/4K3 w - - 0 1", { { "e7e8q", true }, { "e7e8r", true }, { "e7e8b", false }, { "e7e8n", false } } },
+				{ "8/1P1k4/8/8/8/8/8/4K3 w - - 0 1", { { "b7b8n", true }, { "b7b8q", false } } } };
+			for (const auto& [fen, moves] : cases)
+			{
+				pos.loadFEN(fen);
+				for (const auto& [move, check] : moves)
+					Assert::AreEqual(check, pos.givesCheck(pos.moveFromUCI(move)));
+			}
+		}
+		// Replays recorded results of search threads through the best thread selection
+		TEST_METHOD(BestThreadVoting)
+		{
+			const Move e2e4(Sq::E2, Sq::E4), d2d4(Sq::D2, Sq::D4), g1f3(Sq::G1, Sq::F3);
+			auto recorded = [](Depth depth, Move bestMove, Score score) {
+				SearchResults results{};
+				results.resDepth = depth;
+				results.bestMove = results.pv[0] = bestMove;
+				results.pvLength = depth > 0 ? 1 : 0;
+				results.score = score;
+				return results;
+			};
+			// Single deeper helper doesn't override consensus of others
+			Assert::AreEqual(size_t(0), MultiSearcher::voteBestResults({
+				recorded(12, e2e4, 30), recorded(12, e2e4, 25), recorded(13, d2d4, 40) }));
+			// But it wins if its score is much better
+			Assert::AreEqual(size_t(2), MultiSearcher::voteBestResults({
+				recorded(12, e2e4, 30), recorded(12, e2e4, 25), recorded(13, d2d4, 120) }));
+			// Deepest of the threads agreeing on the best move is taken
+			Assert::AreEqual(size_t(3), MultiSearcher::voteBestResults({
+				recorded(10, g1f3, 15), recorded(11, e2e4, 20), recorded(10, e2e4, 22), recorded(12, e2e4, 18) }));
+			// Threads without completed iterations don't vote
+			Assert::AreEqual(size_t(1), MultiSearcher::voteBestResults({
+				recorded(0, MOVE_NONE, SCORE_ZERO), recorded(9, d2d4, -10), recorded(0, MOVE_NONE, SCORE_ZERO) }));
+			// The shortest proven win is preferred over votes
+			Assert::AreEqual(size_t(2), MultiSearcher::voteBestResults({
+				recorded(14, e2e4, 50), recorded(14, e2e4, 55), recorded(9, g1f3, SCORE_WIN - 7),
+				recorded(11, d2d4, SCORE_WIN - 9) }));
 		}
 	};
 }
\ No newline at end of file
@@ -9,7 +9,15 @@
 #include <algorithm>
 #include <numeric>
 #include <variant>
+#include <chrono>
+#include <random>
 #include "../engine/engine.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace BlendXChess;
@@ -53,6 +61,53 @@ void errorLog(const string& what)
 	logFS << what << endl;
 }
 
+//============================================================
+// Parses search limits from tokens of 'go' command
+//============================================================
+SearchLimits parseGoLimits(const vector<string>& tokens)
+{
+	SearchLimits limits;
+	// Reads numeric value of the token at given index (negative clock time, which
+	// GUIs send when the time is overdrawn, is treated as zero)
+	auto value = [&tokens](size_t idx) {
+		long long result;
+		istringstream iss(idx < tokens.size() ? tokens[idx] : "");
+		const bool clock = tokens[idx - 1] == "wtime" || tokens[idx - 1] == "btime";
+		if (!(iss >> result) || (result < 0 && !clock))
+			throw runtime_error("Wrong value of '" + tokens[idx - 1] + "' in 'go' command");
+		return max(result, 0LL);
+	};
+	for (size_t i = 1; i < tokens.size(); ++i)
+	{
+		const string& token = tokens[i];
+		if (token == "wtime" || token == "btime")
+		{
+			const Color c = token == "wtime" ? WHITE : BLACK;
+			limits.time[c] = value(++i);
+			limits.timeGiven[c] = true;
+		}
+		else if (token == "winc")
+			limits.inc[WHITE] = value(++i);
+		else if (token == "binc")
+			limits.inc[BLACK] = value(++i);
+		else if (token == "movestogo")
+			limits.movesToGo = int(value(++i));
+		else if (token == "movetime")
+			limits.moveTime = value(++i);
+		else if (token == "depth")
+			limits.depth = Depth(min<long long>(value(++i), SEARCH_DEPTH_MAX));
+		else if (token == "nodes")
+			limits.nodes = value(++i);
+		else if (token == "infinite")
+			limits.infinite = true;
+		else if (token == "ponder")
+			limits.ponder = true;
+		else
+			errorLog("Warning: unsupported 'go' argument '" + token + "', ignored");
+	}
+	return limits;
+}
+
 //============================================================
 // Stream structs for communication with UCI
 // Support dump of I/O operations
@@ -153,6 +208,28 @@ UCIOStream uci_out;
 // for one LOGICAL command, thus it's not used in UCI(I/O)Stream)
 mutex ioMutex;
 
+//============================================================
+// Principal variation in UCI notation
+//============================================================
+string pvToUCI(const SearchResults& res)
+{
+	string pv;
+	for (int i = 0; i < res.pvLength; ++i)
+		pv += (i ? " " : "") + res.pv[i].toUCI();
+	return pv;
+}
+
+//============================================================
+// Sends best move (and expected reply, if known, for pondering)
+//============================================================
+void sendBestMove(const SearchResults& res)
+{
+	uci_out << "bestmove " << res.bestMove.toUCI();
+	if (res.pvLength > 1 && res.pv[0] == res.bestMove)
+		uci_out << " ponder " << res.pv[1].toUCI();
+	uci_out << uci_endl;
+}
+
 //============================================================
 // Informs UCI about engine events (is set as processer to searcher)
 //============================================================
@@ -163,17 +240,371 @@ void UCIInformer(const SearchEvent& event)
 	switch (event.type)
 	{
 	case SearchEventType::FINISHED:
-		uci_out << "bestmove " << res.bestMove.toUCI() << uci_endl;
+		sendBestMove(res);
 		break;
 	case SearchEventType::INFO:
 		uci_out << "info depth " << (int)res.resDepth << " score cp " << res.score
-		     << " pv " << res.bestMove.toUCI() << " nodes " << stats.visitedNodes << uci_endl;
+		     << " nodes " << stats.visitedNodes << " pv " << pvToUCI(res) << uci_endl;
 		break;
 	default:
 		errorLog("Unrecognized event type " + to_string((int)event.type));
 	}
 }
 
+//============================================================
+// Runs perft on current position (non-standard 'perft <depth> [threads N] [hash MB]'
+// command). Leaf count of each root move is reported, then total count and speed
+//============================================================
+void runPerft(Game& game, const vector<string>& tokens)
+{
+	long long depth;
+	int threadCount = 1;
+	long long hashSizeMB = 0;
+	istringstream iss(tokens.size() > 1 ? tokens[1] : "");
+	if (!(iss >> depth) || depth < 0 || depth > SEARCH_DEPTH_MAX)
+		throw runtime_error("Wrong depth in 'perft' command");
+	for (size_t idx = 2; idx + 1 < tokens.size(); idx += 2)
+	{
+		istringstream argIss(tokens[idx + 1]);
+		if (tokens[idx] == "threads")
+		{
+			if (!(argIss >> threadCount) || threadCount <= 0 || threadCount > max(game.getMaxThreadCount(), 1))
+				throw runtime_error("Wrong thread count in 'perft' command");
+		}
+		else if (tokens[idx] == "hash")
+		{
+			if (!(argIss >> hashSizeMB) || hashSizeMB < 0 || hashSizeMB > (long long)PERFT_HASH_SIZE_MAX)
+				throw runtime_error("Wrong hash size in 'perft' command");
+		}
+		else
+			throw runtime_error("Unrecognized argument '" + tokens[idx] + "' in 'perft' command");
+	}
+	uint64_t nodes = 0;
+	const auto st = chrono::steady_clock::now();
+	for (const auto& [move, moveNodes] : threadCount > 1 || hashSizeMB > 0 ?
+		game.parallelPerftDivide(Depth(depth), threadCount, hashSizeMB) : game.perftDivide<true>(Depth(depth)))
+	{
+		uci_out << move.toUCI() << ": " << moveNodes << uci_endl;
+		nodes += moveNodes;
+	}
+	const auto en = chrono::steady_clock::now();
+	const long long us = max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count());
+	uci_out << uci_endl << "Nodes searched: " << nodes << uci_endl;
+	uci_out << "Time: " << us / 1000 << " ms, nps: " << nodes * 1000000 / us << uci_endl;
+}
+
+//============================================================
+// Runs perft suite from EPD file (non-standard 'perftsuite <file> [max depth]'
+// command). Each line is a FEN (counters are optional) followed by expected
+// leaf counts in ';D<depth> <count>' fields, ones deeper than max depth are skipped
+// Every checked count is reported with its speed, then totals of the whole suite
+//============================================================
+void runPerftSuite(const vector<string>& tokens)
+{
+	if (tokens.size() < 2)
+		throw runtime_error("Missing EPD file in 'perftsuite' command");
+	long long maxDepth = SEARCH_DEPTH_MAX;
+	if (tokens.size() > 2)
+	{
+		istringstream iss(tokens[2]);
+		if (!(iss >> maxDepth) || maxDepth < 0 || maxDepth > SEARCH_DEPTH_MAX)
+			throw runtime_error("Wrong max depth in 'perftsuite' command");
+	}
+	ifstream epd(tokens[1]);
+	if (!epd.is_open())
+		throw runtime_error("Can't open EPD file '" + tokens[1] + "'");
+	int checked = 0, failed = 0, lineIdx = 0;
+	uint64_t totalNodes = 0;
+	long long totalUs = 0;
+	Position pos;
+	for (string line; getline(epd, line); )
+	{
+		++lineIdx;
+		const vector<string> fields = tokenize(line.substr(0, line.find(';')));
+		if (fields.empty() || fields[0][0] == '#')
+			continue;
+		const string fen = accumulate(fields.begin() + 1, fields.end(), fields[0],
+			[](const string& s1, const string& s2) {return s1 + " " + s2; });
+		pos.loadFEN(fen, fields.size() < 6);
+		uci_out << "Line " << lineIdx << ": " << fen << uci_endl;
+		for (size_t fieldStart = line.find(';'); fieldStart != string::npos; )
+		{
+			const size_t fieldEnd = line.find(';', fieldStart + 1);
+			istringstream fieldIss(line.substr(fieldStart + 1, fieldEnd - fieldStart - 1));
+			fieldStart = fieldEnd;
+			char depthTag;
+			long long depth;
+			uint64_t expected;
+			if (!(fieldIss >> depthTag >> depth >> expected) || depthTag != 'D')
+				throw runtime_error("Wrong perft field at line " + to_string(lineIdx) + " of EPD file");
+			if (depth > maxDepth)
+				continue;
+			const auto st = chrono::steady_clock::now();
+			const uint64_t nodes = pos.perft<true>(Depth(depth));
+			const auto en = chrono::steady_clock::now();
+			const long long us = max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count());
+			++checked;
+			totalNodes += nodes;
+			totalUs += us;
+			if (nodes != expected)
+				++failed;
+			uci_out << "  depth " << depth << ": " << nodes << (nodes == expected ? " ok" :
+				" FAILED (expected " + to_string(expected) + ")") << ", " << us / 1000
+				<< " ms, nps: " << nodes * 1000000 / us << uci_endl;
+		}
+	}
+	uci_out << uci_endl << "Checked: " << checked << ", failed: " << failed << uci_endl;
+	uci_out << "Nodes: " << totalNodes << ", time: " << totalUs / 1000 << " ms, nps: "
+		<< totalNodes * 1000000 / max<long long>(1, totalUs) << uci_endl;
+}
+
+//============================================================
+// Measures speed of sliding attacks lookups with each available indexing (or of computed
+// attacks in compact mode) over random occupancies (non-standard 'sliderbench [million
+// lookups]' command)
+//============================================================
+void runSliderBench(const vector<string>& tokens)
+{
+	long long lookups = 100;
+	istringstream iss(tokens.size() > 1 ? tokens[1] : "100");
+	if (!(iss >> lookups) || lookups <= 0)
+		throw runtime_error("Wrong lookup count in 'sliderbench' command");
+	lookups *= 1000000;
+	// Occupancies are ANDs of two random bitboards, so a quarter of the board is occupied on average
+	constexpr int SAMPLE_CNT = 1 << 12;
+	mt19937_64 rng(2023);
+	vector<pair<Square, Bitboard>> samples(SAMPLE_CNT);
+	for (auto& [sq, occupancy] : samples)
+		sq = Square(rng() % SQUARE_CNT), occupancy = rng() & rng();
+	const bool defaultPext = bbUsePext;
+	for (const bool usePext : { false, true })
+	{
+		initSliderAttacks(usePext);
+		if (bbUsePext != usePext)
+			continue;
+		Bitboard checksum = 0;
+		const auto st = chrono::steady_clock::now();
+		for (long long idx = 0; idx < lookups; idx += 2)
+		{
+			const auto& [sq, occupancy] = samples[idx & (SAMPLE_CNT - 1)];
+			checksum ^= magicRookAttacks(sq, occupancy) ^ magicBishopAttacks(sq, occupancy);
+		}
+		const auto en = chrono::steady_clock::now();
+		const long long us = max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count());
+		// Compact attack tables have no lookup tables, attacks are computed then
+		uci_out << (BB_COMPACT_MODE ? "Hyperbola quintessence" : usePext ? "PEXT" : "Magic")
+			<< (usePext == defaultPext ? " (default)" : "")
+			<< ": " << us / 1000 << " ms, " << double(us) * 1000 / lookups << " ns/lookup, checksum "
+			<< hex << checksum << dec << uci_endl;
+	}
+	initSliderAttacks(defaultPext);
+}
+
+//============================================================
+// Positions used by benchmark commands (well-known perft positions)
+//============================================================
+vector<Position> benchPositions(void)
+{
+	static const char* const FENS[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10" };
+	vector<Position> positions(size(FENS));
+	for (size_t idx = 0; idx < positions.size(); ++idx)
+		positions[idx].loadFEN(FENS[idx]);
+	return positions;
+}
+
+//============================================================
+// Measures speed of loops over bitboards which depend on bit operations (non-standard
+// 'bitbench [passes]' command): move generation (perft) and evaluation-like loops
+// (mobility of sliders and count of attackers of each square)
+//============================================================
+void runBitBench(const vector<string>& tokens)
+{
+	int passes = 100;
+	istringstream iss(tokens.size() > 1 ? tokens[1] : "100");
+	if (!(iss >> passes) || passes <= 0)
+		throw runtime_error("Wrong pass count in 'bitbench' command");
+	constexpr Depth PERFT_DEPTH = 3;
+	vector<Position> positions = benchPositions();
+	auto report = [](const char* name, chrono::steady_clock::duration time, uint64_t units, const char* unitName) {
+		const long long us = max<long long>(1, chrono::duration_cast<chrono::microseconds>(time).count());
+		uci_out << name << ": " << us / 1000 << " ms, " << double(us) * 1000 / units << " ns per " << unitName << uci_endl;
+	};
+	// Move generation
+	uint64_t leaves = 0;
+	auto st = chrono::steady_clock::now();
+	for (int pass = 0; pass < passes; ++pass)
+		for (Position& pos : positions)
+			leaves += pos.perft<true>(PERFT_DEPTH);
+	report("Move generation", chrono::steady_clock::now() - st, leaves, "perft leaf");
+	// Evaluation-like loops
+	uint64_t evalSum = 0;
+	const uint64_t evalCalls = uint64_t(passes) * 1000 * positions.size();
+	st = chrono::steady_clock::now();
+	for (int pass = 0; pass < passes * 1000; ++pass)
+		for (const Position& pos : positions)
+		{
+			const Bitboard occupancy = pos.occupiedBB();
+			for (Side side : { WHITE, BLACK })
+			{
+				for (Bitboard sliders = pos.pieceBB(side, BISHOP) | pos.pieceBB(side, QUEEN); sliders; )
+					evalSum += countSet(magicBishopAttacks(popLSB(sliders), occupancy));
+				for (Bitboard sliders = pos.pieceBB(side, ROOK) | pos.pieceBB(side, QUEEN); sliders; )
+					evalSum += countSet(magicRookAttacks(popLSB(sliders), occupancy));
+				for (Bitboard pieces = pos.pieceBB(side, KNIGHT) | pos.pieceBB(side, KING); pieces; )
+					evalSum += countSet(pos.allAttackers(popLSB(pieces), opposite(side)));
+			}
+		}
+	report("Evaluation loops", chrono::steady_clock::now() - st, evalCalls, "position");
+	uci_out << "Checksum: " << leaves + evalSum << uci_endl;
+}
+
+//============================================================
+// Counters of L1 data cache and last level cache read misses
+// of this thread (Linux perf events, if they are available)
+//============================================================
+class CacheMissCounters
+{
+public:
+	CacheMissCounters(void)
+	{
+#ifdef __linux__
+		const uint64_t caches[COUNTER_CNT] = { PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_LL };
+		for (int idx = 0; idx < COUNTER_CNT; ++idx)
+		{
+			perf_event_attr attr{};
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = caches[idx] | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fds[idx] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#endif
+	}
+	~CacheMissCounters(void)
+	{
+#ifdef __linux__
+		for (const int fd : fds)
+			if (fd >= 0)
+				close(fd);
+#endif
+	}
+	bool available(void) const
+	{
+		return fds[0] >= 0 && fds[1] >= 0;
+	}
+	void start(void)
+	{
+#ifdef __linux__
+		for (const int fd : fds)
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+	}
+	// Returns L1 and LLC misses since start
+	array<uint64_t, 2> stop(void)
+	{
+		array<uint64_t, 2> counts{};
+#ifdef __linux__
+		for (int idx = 0; idx < COUNTER_CNT; ++idx)
+			if (fds[idx] >= 0)
+			{
+				ioctl(fds[idx], PERF_EVENT_IOC_DISABLE, 0);
+				if (read(fds[idx], &counts[idx], sizeof(counts[idx])) != sizeof(counts[idx]))
+					counts[idx] = 0;
+			}
+#endif
+		return counts;
+	}
+private:
+	static constexpr int COUNTER_CNT = 2;
+	int fds[COUNTER_CNT] = { -1, -1 };
+};
+
+//============================================================
+// Measures cache misses and speed of isAttacked and move generator with current attack
+// tables (non-standard 'attackbench [thrash MB]' command). Unless thrash size is 0, search
+// memory traffic is imitated by reading random cache lines of a buffer of given size
+// between positions in isAttacked part and by perft hash table in generator part
+//============================================================
+void runAttackBench(const vector<string>& tokens)
+{
+	constexpr long long THRASH_SIZE_MAX = 4096;
+	long long thrashMB = 64;
+	istringstream iss(tokens.size() > 1 ? tokens[1] : "64");
+	if (!(iss >> thrashMB) || thrashMB < 0 || thrashMB > THRASH_SIZE_MAX)
+		throw runtime_error("Wrong thrash size in 'attackbench' command");
+	constexpr Depth PERFT_DEPTH = 4;
+	constexpr int ATTACK_PASSES = 20000, THRASH_READS = 16;
+	const vector<Position> positions = benchPositions();
+	vector<uint64_t> thrashBuffer;
+	try
+	{
+		thrashBuffer.resize(thrashMB * 1024 * 1024 / sizeof(uint64_t) + 1);
+	}
+	catch (const bad_alloc&)
+	{
+		throw runtime_error("Can't allocate thrash buffer of " + to_string(thrashMB) + " MB");
+	}
+	mt19937_64 rng(2023);
+	// Buffer is filled so that its pages are really allocated and not shared zero pages
+	for (uint64_t& word : thrashBuffer)
+		word = rng() & 1;
+	CacheMissCounters counters;
+	auto report = [&counters](const char* name, long long us, uint64_t calls, const array<uint64_t, 2>& misses) {
+		uci_out << name << ": " << us / 1000 << " ms, " << double(us) * 1000 / calls << " ns per call";
+		if (counters.available())
+			uci_out << ", L1 misses per call " << double(misses[0]) / calls
+				<< ", LLC misses per call " << double(misses[1]) / calls;
+		uci_out << uci_endl;
+	};
+	if (!counters.available())
+		uci_out << "Cache miss counters are not available, only speed is measured" << uci_endl;
+	uci_out << "Compact attack tables: " << (BB_COMPACT_MODE ? "on" : "off") << ", thrash: "
+		<< thrashMB << " MB" << uci_endl;
+	// isAttacked for each square by each side
+	uint64_t attacked = 0, thrashSum = 0;
+	counters.start();
+	auto st = chrono::steady_clock::now();
+	for (int pass = 0; pass < ATTACK_PASSES; ++pass)
+		for (const Position& pos : positions)
+		{
+			if (thrashMB)
+				for (int readIdx = 0; readIdx < THRASH_READS; ++readIdx)
+					thrashSum += thrashBuffer[rng() % thrashBuffer.size()];
+			for (Square sq = Sq::A1; sq < SQUARE_CNT; ++sq)
+				attacked += pos.isAttacked(sq, WHITE) + pos.isAttacked(sq, BLACK);
+		}
+	auto en = chrono::steady_clock::now();
+	array<uint64_t, 2> misses = counters.stop();
+	report("isAttacked", max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count()),
+		uint64_t(ATTACK_PASSES) * positions.size() * SQUARE_CNT * 2, misses);
+	// Move generator (perft leaves are counted in bulk, so it is dominated by generation)
+	uint64_t leaves = 0;
+	ParallelPerft perft(1, thrashMB);
+	counters.start();
+	st = chrono::steady_clock::now();
+	for (const Position& pos : positions)
+		for (const auto& [move, nodes] : perft.divide(pos, PERFT_DEPTH))
+			leaves += nodes;
+	en = chrono::steady_clock::now();
+	misses = counters.stop();
+	report("Generator (per perft leaf)", max<long long>(1, chrono::duration_cast<chrono::microseconds>(en - st).count()),
+		leaves, misses);
+	uci_out << "Checksum: " << attacked + leaves + thrashSum << uci_endl;
+}
+
 //============================================================
 // Main function
 //============================================================
@@ -207,6 +638,11 @@ int main(int argc, char **argv)
 				     << " min 1 max " << game.getMaxThreadCount() << uci_endl;
 				uci_out << "option name SearchDepth type spin default " << (int)SEARCH_DEPTH_DEFAULT
 				     << " min " << (int)SEARCH_DEPTH_MIN << " max " << (int)SEARCH_DEPTH_MAX << uci_endl;
+				uci_out << "option name MoveOverhead type spin default " << MOVE_OVERHEAD_DEFAULT
+				     << " min " << MOVE_OVERHEAD_MIN << " max " << MOVE_OVERHEAD_MAX << uci_endl;
+				uci_out << "option name SMPMode type combo default Lazy var Lazy var YBWC" << uci_endl;
+				uci_out << "option name SMPDepthSkipping type check default true" << uci_endl;
+				uci_out << "option name NumaPinning type check default false" << uci_endl;
 				uci_out << "uciok" << uci_endl;
 			}
 			else if (command == "isready")
@@ -226,7 +662,7 @@ int main(int argc, char **argv)
 			}
 			else if (command == "ucinewgame")
 			{
-				game.reset();
+				game.newGame();
 			}
 			else if (command == "position")
 			{
@@ -260,7 +696,7 @@ int main(int argc, char **argv)
 			}
 			else if (command == "go")
 			{
-				game.startSearch();
+				game.startSearch(parseGoLimits(tokens));
 			}
 			else if (command == "stop")
 			{
@@ -270,11 +706,46 @@ int main(int argc, char **argv)
 					continue;
 				}
 				auto[results, stats] = game.endSearch();
-				uci_out << "bestmove " << results.bestMove.toUCI() << uci_endl;
+				sendBestMove(results);
+			}
+			else if (command == "perft")
+			{
+				if (game.isInSearch())
+					errorLog("Warning: received 'perft' command while in search, ignored");
+				else
+					runPerft(game, tokens);
+			}
+			else if (command == "perftsuite")
+			{
+				if (game.isInSearch())
+					errorLog("Warning: received 'perftsuite' command while in search, ignored");
+				else
+					runPerftSuite(tokens);
+			}
+			else if (command == "sliderbench")
+			{
+				if (game.isInSearch())
+					errorLog("Warning: received 'sliderbench' command while in search, ignored");
+				else
+					runSliderBench(tokens);
+			}
+			else if (command == "bitbench")
+			{
+				if (game.isInSearch())
+					errorLog("Warning: received 'bitbench' command while in search, ignored");
+				else
+					runBitBench(tokens);
+			}
+			else if (command == "attackbench")
+			{
+				if (game.isInSearch())
+					errorLog("Warning: received 'attackbench' command while in search, ignored");
+				else
+					runAttackBench(tokens);
 			}
 			else if (command == "ponderhit")
 			{
-				// EMPTY NOW
+				game.ponderHit();
 			}
 			else if (command == "quit")
 			{
@@ -33,7 +33,8 @@ namespace BlendXChess
 
 	constexpr int8_t FILE_CNT = 8, FILE_MIN = 0, FILE_MAX = 7, RANK_CNT = 8, RANK_MIN = 0,
 		RANK_MAX = 7, DIAG_CNT = 15, SQUARE_CNT = FILE_CNT * RANK_CNT,
-		COLOR_CNT = 2, PIECETYPE_CNT = 7, MAX_PIECES_OF_ONE_TYPE = 9, CASTLING_SIDE_CNT = 2;
+		COLOR_CNT = 2, PIECETYPE_CNT = 7, PIECE_CNT = COLOR_CNT << 3,
+		MAX_PIECES_OF_ONE_TYPE = 9, CASTLING_SIDE_CNT = 2;
 	constexpr int16_t MAX_GAME_PLY = 1024, MAX_SEARCH_PLY = 100;
 
 	//============================================================
@@ -104,7 +105,7 @@ namespace BlendXChess
 	};
 	// Scores
 	enum : Score {
-		SCORE_ZERO = 0, SCORE_LOSE = -30000, SCORE_WIN = 30000,
+		SCORE_ZERO = 0, SCORE_LOSE = -30000, SCORE_WIN = 30000, SCORE_NONE = SCORE_WIN + 1,
 		SCORE_LOSE_MAX = SCORE_LOSE + MAX_GAME_PLY, SCORE_WIN_MIN = SCORE_WIN - MAX_GAME_PLY
 	};
 	// Squares
@@ -243,7 +244,7 @@ namespace BlendXChess
 
 	constexpr inline int8_t rankFromAN(char rankAN) noexcept
 	{
-		return (int8_t)(rankAN - 'a');
+		return (int8_t)(rankAN - '1');
 	}
 
 	constexpr inline char rankToAN(int8_t rank) noexcept
@@ -542,9 +543,10 @@ namespace BlendXChess
 	};
 
 	// Manhattan distance between squares
-	inline int8_t distance(Square sq1, Square sq2) noexcept
+	constexpr inline int8_t distance(Square sq1, Square sq2) noexcept
 	{
-		return abs(sq1.rank() - sq2.rank()) + abs(sq1.file() - sq2.file());
+		const int8_t rankDiff = sq1.rank() - sq2.rank(), fileDiff = sq1.file() - sq2.file();
+		return (rankDiff < 0 ? -rankDiff : rankDiff) + (fileDiff < 0 ? -fileDiff : fileDiff);
 	}
 	// Square relative to a given side (flips row if c is BLACK)
 	constexpr inline Square relSquare(Square sq, Side c) noexcept
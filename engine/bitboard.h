@@ -9,6 +9,37 @@
 #include <string>
 #include "basic_types.h"
 
+// Indexing of sliding attacks table: with BB_PEXT defined as 1 BMI2 PEXT instruction is always
+// used, with 0 magic multiplication is. Otherwise (on x86-64 only) it is chosen at startup by CPUID
+#if !defined BB_PEXT && !(defined __x86_64__ || defined _M_X64)
+#define BB_PEXT 0
+#endif
+#if (!defined BB_PEXT || BB_PEXT) && (defined _MSC_VER || defined __BMI2__)
+#include <immintrin.h>
+#endif
+// Compact attack tables: with BB_COMPACT defined as 1, sliding attacks are computed (by hyperbola
+// quintessence and a small table of first rank attacks) instead of being looked up in the large
+// magic table, and so are in-between squares and lines through two squares instead of 64x64 tables
+#if !defined BB_COMPACT
+#define BB_COMPACT 0
+#endif
+#if BB_COMPACT
+#undef BB_PEXT
+#define BB_PEXT 0
+#endif
+#if defined _MSC_VER
+#include <cstdlib>
+#endif
+// Bit operations use C++20 <bit> if it is available, otherwise compiler builtins or portable code
+#if defined __has_include
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined __cpp_lib_bitops
+#include <bit>
+#endif
+
 namespace BlendXChess
 {
 
@@ -26,7 +57,7 @@ namespace BlendXChess
 	};
 
 	//============================================================
-	// Constants and global variables
+	// Constants
 	//============================================================
 
 	constexpr Bitboard BB_RANK_1 = 0xff;
@@ -45,24 +76,281 @@ namespace BlendXChess
 	constexpr Bitboard BB_FILE_F = BB_FILE_A << 5;
 	constexpr Bitboard BB_FILE_G = BB_FILE_A << 6;
 	constexpr Bitboard BB_FILE_H = BB_FILE_A << 7;
-	extern Bitboard bbRank[RANK_CNT];
-	extern Bitboard bbFile[FILE_CNT];
-	extern Bitboard bbSquare[SQUARE_CNT];
-	extern Bitboard bbDiagonal[DIAG_CNT];
-	extern Bitboard bbAntidiagonal[DIAG_CNT];
-	extern Bitboard bbPawnQuiet[COLOR_CNT][SQUARE_CNT];
-	extern Bitboard bbPawnAttack[COLOR_CNT][SQUARE_CNT];
-	extern Bitboard bbAttackEB[PIECETYPE_CNT][SQUARE_CNT]; // attack bitboard for pieces (except pawns) on empty board
-	extern Bitboard(&bbKnightAttack)[SQUARE_CNT];
-	extern Bitboard(&bbKingAttack)[SQUARE_CNT];
-	extern Bitboard bbCastlingInner[COLOR_CNT][CASTLING_SIDE_CNT];
-	extern Bitboard bbBetween[SQUARE_CNT][SQUARE_CNT];
-	extern Magic mRookMagics[SQUARE_CNT];
-	extern Magic mBishopMagics[SQUARE_CNT];
+#if defined BB_PEXT
+	constexpr bool BB_PEXT_DISPATCH = false, BB_PEXT_ALWAYS = BB_PEXT;
+#else
+	constexpr bool BB_PEXT_DISPATCH = true, BB_PEXT_ALWAYS = false;
+#endif
+	constexpr bool BB_COMPACT_MODE = BB_COMPACT;
+	// Magic multipliers (found by PRNG search which was earlier run at every startup)
+	// Any other valid ones may be put here, verifyBB checks them against lineAttacks
+	constexpr Bitboard ROOK_MAGIC_MUL[SQUARE_CNT] = {
+		0x0680004002809029ULL, 0x244000a000100040ULL, 0x008010008108a002ULL, 0x0080044800100082ULL,
+		0x0080220800040080ULL, 0x01000c0081000208ULL, 0x0200040a82000128ULL, 0x0200040a01c8a081ULL,
+		0x0280802040018008ULL, 0x00624000201002c0ULL, 0x000c808010002000ULL, 0x0111000810010020ULL,
+		0x0420800802806400ULL, 0x010a808004000200ULL, 0x0801000d00020024ULL, 0x0082000084044102ULL,
+		0x2402808000604002ULL, 0x0030004004200042ULL, 0x0f10008080200010ULL, 0x0005090010002500ULL,
+		0x040c008008000480ULL, 0x0062008044008002ULL, 0x2000040010080209ULL, 0x000242000c224081ULL,
+		0x0040005880008025ULL, 0x0021410200608202ULL, 0x062000a080100880ULL, 0x00020042000a2010ULL,
+		0x026c008080080105ULL, 0x1001004900240002ULL, 0x0106020400192810ULL, 0x040800c200090084ULL,
+		0x0810400020800488ULL, 0x0810082000400049ULL, 0x0001801000802000ULL, 0x0486100180800801ULL,
+		0x0001001803000c10ULL, 0x0000800400800200ULL, 0x0080080204000110ULL, 0x208100a402001041ULL,
+		0x1028804000228006ULL, 0x3441200250004008ULL, 0x0001200011010040ULL, 0x0829100021010008ULL,
+		0x0002000810860020ULL, 0x200200100826000cULL, 0x0090220841040010ULL, 0x2006008104c20004ULL,
+		0x0010218000c10500ULL, 0x0088802100520a00ULL, 0x0200201040820200ULL, 0x0800205001004900ULL,
+		0x1508020104004040ULL, 0x1001020044008080ULL, 0x021202d108100400ULL, 0x000014cc01008200ULL,
+		0x2000800014204501ULL, 0x0001004000e47081ULL, 0x0011120020800842ULL, 0x00020c2010000901ULL,
+		0x0002008408116002ULL, 0x0802001008030402ULL, 0x0500410288101204ULL, 0x01502412804100a6ULL
+	};
+	constexpr Bitboard BISHOP_MAGIC_MUL[SQUARE_CNT] = {
+		0x1040820404008018ULL, 0x2084040401420080ULL, 0x0010210c4500d080ULL, 0x1060a09080440000ULL,
+		0x2828484008000d05ULL, 0x000a021005284204ULL, 0x0021040121280008ULL, 0x0002008404115c00ULL,
+		0x0100041010020490ULL, 0x0000105030848880ULL, 0x0080104100c10800ULL, 0x08001820c2c00002ULL,
+		0x0000111040002102ULL, 0x280002822160000bULL, 0x2002088814026004ULL, 0x0c08004202100602ULL,
+		0x0020000420040112ULL, 0x000801e410441149ULL, 0x1410010204801100ULL, 0x002080480200c00cULL,
+		0x1004080080a00040ULL, 0x10020002c0500401ULL, 0x10006044020a1000ULL, 0x000080004c041110ULL,
+		0x0108400084500600ULL, 0x2090038110040100ULL, 0x0000480081080100ULL, 0x0001004004004200ULL,
+		0x0000840000806008ULL, 0x000200200a009044ULL, 0x00c40082014e1000ULL, 0x1009092001042100ULL,
+		0x0008021095420400ULL, 0x2015041000221000ULL, 0x220010c800840800ULL, 0x0000208020880201ULL,
+		0x0004080200106008ULL, 0x21200200804c0883ULL, 0x00020c0044012800ULL, 0x020d084200008a00ULL,
+		0x051a081c04004014ULL, 0x0053181210000260ULL, 0x00448240c04a4800ULL, 0x0284120102402c00ULL,
+		0x00082020a0810402ULL, 0x026040b112008040ULL, 0x0408082100400401ULL, 0x0001040086008080ULL,
+		0x2844120104202001ULL, 0x06004108080b0200ULL, 0x020001009090440fULL, 0x0040001420880481ULL,
+		0x01000840082a0400ULL, 0x3600202006008001ULL, 0x0004501002408800ULL, 0x0102080801024004ULL,
+		0x1302010442122050ULL, 0x2482010100a22001ULL, 0x1400000200840442ULL, 0x0830008068420208ULL,
+		0x2180000812820605ULL, 0x0c92000810110604ULL, 0x0020421801040080ULL, 0x0208205801c908e2ULL
+	};
+
+	//============================================================
+	// Bit operations (they are also usable at compile time)
+	//============================================================
+
+	// Count set bits in given bitboard
+	constexpr inline int countSet(Bitboard bb) noexcept
+	{
+#if defined __cpp_lib_bitops
+		return std::popcount(bb);
+#elif defined __GNUG__
+		return __builtin_popcountll(bb);
+#else
+		bb -= (bb >> 1) & 0x5555555555555555ULL;
+		bb = (bb & 0x3333333333333333ULL) + ((bb >> 2) & 0x3333333333333333ULL);
+		bb = (bb + (bb >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return int((bb * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	// Get least significant bit of a bitboard (which shouldn't be empty)
+	constexpr inline Square getLSB(Bitboard bb) noexcept
+	{
+#if defined __cpp_lib_bitops
+		return Square(SquareRaw(std::countr_zero(bb)));
+#elif defined __GNUG__
+		return Square(SquareRaw(__builtin_ctzll(bb)));
+#else
+		SquareRaw lsb = 0;
+		// Binary search
+		if ((bb & 0xffffffff) == 0)
+			lsb += 32, bb >>= 32;
+		if ((bb & 0xffff) == 0)
+			lsb += 16, bb >>= 16;
+		if ((bb & 0xff) == 0)
+			lsb += 8, bb >>= 8;
+		if ((bb & 0xf) == 0)
+			lsb += 4, bb >>= 4;
+		if ((bb & 0x3) == 0)
+			lsb += 2, bb >>= 2;
+		if ((bb & 0x1) == 0)
+			++lsb;
+		return Square(lsb);
+#endif
+	}
+
+	// Get least significant bit of a bitboard (which shouldn't be empty) and clear it
+	constexpr inline Square popLSB(Bitboard& bb) noexcept
+	{
+		const Square lsb = getLSB(bb);
+		bb &= bb - 1;
+		return lsb;
+	}
+
+	//============================================================
+	// Compile-time computation of fixed tables
+	//============================================================
+
+	// All bitboard tables which don't depend on anything but board geometry
+	struct BBTables
+	{
+		Bitboard rank[RANK_CNT] = {};
+		Bitboard file[FILE_CNT] = {};
+		Bitboard square[SQUARE_CNT] = {};
+		Bitboard diagonal[DIAG_CNT] = {};
+		Bitboard antidiagonal[DIAG_CNT] = {};
+		Bitboard pawnQuiet[COLOR_CNT][SQUARE_CNT] = {};
+		Bitboard pawnAttack[COLOR_CNT][SQUARE_CNT] = {};
+		Bitboard attackEB[PIECETYPE_CNT][SQUARE_CNT] = {};
+		Bitboard castlingInner[COLOR_CNT][CASTLING_SIDE_CNT] = {};
+		Bitboard between[SQUARE_CNT][SQUARE_CNT] = {};
+		Bitboard line[SQUARE_CNT][SQUARE_CNT] = {};
+		// Attacks on the first rank by file and occupancy of 6 inner squares
+		uint8_t firstRankAttacks[FILE_CNT][1 << 6] = {};
+	};
+
+	constexpr BBTables makeBBTables(void)
+	{
+		using namespace Sq;
+		BBTables t;
+		// Ranks, files and squares
+		for (int8_t i = 0; i < RANK_CNT; ++i)
+			t.rank[i] = BB_RANK_1 << (8 * i);
+		for (int8_t i = 0; i < FILE_CNT; ++i)
+			t.file[i] = BB_FILE_A << i;
+		for (int sq = A1; sq < SQUARE_CNT; ++sq)
+			t.square[sq] = 1ull << sq;
+		// Diagonals and antidiagonals
+		for (int8_t i = 0; i < DIAG_CNT; ++i)
+		{
+			for (int8_t r = (i > 7 ? i - 7 : 0), c = (i > 7 ? 0 : 7 - i); r < 8 && c < 8; ++r, ++c)
+				t.diagonal[i] |= t.square[Square(r, c)];
+			for (int8_t r = (i > 7 ? 7 : i), c = (i > 7 ? i - 7 : 0); r >= 0 && c < 8; --r, ++c)
+				t.antidiagonal[i] |= t.square[Square(r, c)];
+		}
+		// Pawn quiet moves and attacks
+		for (Side c = WHITE; c <= BLACK; ++c)
+		{
+			const int forward = (c == WHITE ? D_UP : D_DOWN);
+			for (int sq = relSquare(A2, c); sq <= relSquare(H2, c); ++sq)
+				t.pawnQuiet[c][sq] = t.square[sq + forward] | t.square[sq + 2 * forward];
+			for (Square sq = A3; sq <= H7; ++sq)
+				t.pawnQuiet[c][relSquare(sq, c)] = t.square[relSquare(sq, c) + forward];
+			for (Square sq = A1; sq <= H8; ++sq)
+			{
+				if (sq.file() != FILE_MIN && Square(sq + forward + D_LEFT).isValid())
+					t.pawnAttack[c][sq] |= t.square[sq + forward + D_LEFT];
+				if (sq.file() != FILE_MAX && Square(sq + forward + D_RIGHT).isValid())
+					t.pawnAttack[c][sq] |= t.square[sq + forward + D_RIGHT];
+			}
+		}
+		// Knight and king attacks
+		constexpr int8_t knightStep[8] = { -17, -15, -10, -6, 6, 10, 15, 17 },
+			kingStep[8] = { D_LD, D_DOWN, D_RD, D_LEFT, D_RIGHT, D_LU, D_UP, D_RU };
+		for (Square sq = A1; sq < SQUARE_CNT; ++sq)
+			for (int d = 0; d < 8; ++d)
+			{
+				const Square knightTo = sq + knightStep[d], kingTo = sq + kingStep[d];
+				if (knightTo.isValid() && distance(sq, knightTo) == 3)
+					t.attackEB[KNIGHT][sq] |= t.square[knightTo];
+				if (kingTo.isValid() && distance(sq, kingTo) <= 2)
+					t.attackEB[KING][sq] |= t.square[kingTo];
+			}
+		// Sliding pieces' attacks on empty board
+		for (Square sq = A1; sq < SQUARE_CNT; ++sq)
+		{
+			t.attackEB[BISHOP][sq] = (t.diagonal[sq.diagonal()] | t.antidiagonal[sq.antidiagonal()])
+				& ~t.square[sq];
+			t.attackEB[ROOK][sq] = (t.rank[sq.rank()] | t.file[sq.file()]) & ~t.square[sq];
+			t.attackEB[QUEEN][sq] = t.attackEB[BISHOP][sq] | t.attackEB[ROOK][sq];
+		}
+		// Whole lines through pairs of aligned squares and in-between (excluding endpoints) squares
+		for (Square sq1 = A1; sq1 <= H8; ++sq1)
+			for (Square sq2 = A1; sq2 <= H8; ++sq2)
+			{
+				if (sq1 == sq2)
+					continue;
+				else if (sq1.rank() == sq2.rank())
+					t.line[sq1][sq2] = t.rank[sq1.rank()];
+				else if (sq1.file() == sq2.file())
+					t.line[sq1][sq2] = t.file[sq1.file()];
+				else if (sq1.diagonal() == sq2.diagonal())
+					t.line[sq1][sq2] = t.diagonal[sq1.diagonal()];
+				else if (sq1.antidiagonal() == sq2.antidiagonal())
+					t.line[sq1][sq2] = t.antidiagonal[sq1.antidiagonal()];
+				const Square low = sq1 < sq2 ? sq1 : sq2, high = sq1 < sq2 ? sq2 : sq1;
+				t.between[sq1][sq2] = t.line[sq1][sq2] & (t.square[high] - (t.square[low] << 1));
+			}
+		// Castling's inners
+		for (Side c = WHITE; c <= BLACK; ++c)
+		{
+			t.castlingInner[c][OO] = t.square[relSquare(G1, c)] | t.square[relSquare(F1, c)];
+			t.castlingInner[c][OOO] = t.square[relSquare(B1, c)] | t.square[relSquare(C1, c)]
+				| t.square[relSquare(D1, c)];
+		}
+		// Attacks on the first rank
+		for (int8_t file = 0; file < FILE_CNT; ++file)
+			for (int occ = 0; occ < (1 << 6); ++occ)
+			{
+				for (int8_t to = file - 1; to >= 0 && (to == file - 1 || !(occ << 1 & 1 << (to + 1))); --to)
+					t.firstRankAttacks[file][occ] |= 1 << to;
+				for (int8_t to = file + 1; to < FILE_CNT && (to == file + 1 || !(occ << 1 & 1 << (to - 1))); ++to)
+					t.firstRankAttacks[file][occ] |= 1 << to;
+			}
+		return t;
+	}
+
+	// Magics of rooks and bishops together with size of the table of their attacks
+	struct MagicTables
+	{
+		Magic rook[SQUARE_CNT] = {};
+		Magic bishop[SQUARE_CNT] = {};
+		int attackTableSize = 0;
+	};
+
+	// Sets up magics given their multipliers and the attack table (which may be
+	// nullptr if only its size is needed). Rooks' attacks are placed before bishops'
+	constexpr MagicTables makeMagics(const BBTables& t, Bitboard* attackTable)
+	{
+		MagicTables m;
+		for (int pieceIdx = 0; pieceIdx < 2; ++pieceIdx)
+			for (Square sq = Sq::A1; sq < SQUARE_CNT; ++sq)
+			{
+				Magic& magic = (pieceIdx == 0 ? m.rook : m.bishop)[sq];
+				// Border (we should carefully handle situations where rook is itself on border)
+				// It remains the same for bishops because 'and' changes don't affect them
+				const Bitboard bbBorder = ((BB_RANK_1 | BB_RANK_8) & ~t.rank[sq.rank()])
+					| ((BB_FILE_A | BB_FILE_H) & ~t.file[sq.file()]);
+				// Relative occupancy mask
+				magic.relOcc = t.attackEB[pieceIdx == 0 ? ROOK : BISHOP][sq] & ~bbBorder;
+				magic.mul = (pieceIdx == 0 ? ROOK_MAGIC_MUL : BISHOP_MAGIC_MUL)[sq];
+				magic.shifts = 64 - countSet(magic.relOcc);
+				magic.attack = attackTable ? attackTable + m.attackTableSize : nullptr;
+				m.attackTableSize += 1 << (64 - magic.shifts);
+			}
+		return m;
+	}
+
+	//============================================================
+	// Global variables
+	//============================================================
+
+	inline constexpr BBTables bbTables = makeBBTables();
+	inline constexpr const Bitboard(&bbRank)[RANK_CNT] = bbTables.rank;
+	inline constexpr const Bitboard(&bbFile)[FILE_CNT] = bbTables.file;
+	inline constexpr const Bitboard(&bbSquare)[SQUARE_CNT] = bbTables.square;
+	inline constexpr const Bitboard(&bbDiagonal)[DIAG_CNT] = bbTables.diagonal;
+	inline constexpr const Bitboard(&bbAntidiagonal)[DIAG_CNT] = bbTables.antidiagonal;
+	inline constexpr const Bitboard(&bbPawnQuiet)[COLOR_CNT][SQUARE_CNT] = bbTables.pawnQuiet;
+	inline constexpr const Bitboard(&bbPawnAttack)[COLOR_CNT][SQUARE_CNT] = bbTables.pawnAttack;
+	// Attack bitboard for pieces (except pawns) on empty board
+	inline constexpr const Bitboard(&bbAttackEB)[PIECETYPE_CNT][SQUARE_CNT] = bbTables.attackEB;
+	inline constexpr const Bitboard(&bbKnightAttack)[SQUARE_CNT] = bbTables.attackEB[KNIGHT];
+	inline constexpr const Bitboard(&bbKingAttack)[SQUARE_CNT] = bbTables.attackEB[KING];
+	inline constexpr const Bitboard(&bbCastlingInner)[COLOR_CNT][CASTLING_SIDE_CNT] = bbTables.castlingInner;
+	inline constexpr const Bitboard(&bbBetween)[SQUARE_CNT][SQUARE_CNT] = bbTables.between;
+	// Whole line through two squares (empty if they are not aligned)
+	inline constexpr const Bitboard(&bbLine)[SQUARE_CNT][SQUARE_CNT] = bbTables.line;
+	inline constexpr const uint8_t(&bbFirstRankAttacks)[FILE_CNT][1 << 6] = bbTables.firstRankAttacks;
+	// Here magic moves are stored ('attack' member of Magic object links somewhere inside this array)
+	// The table itself is filled at runtime by initBB
+	extern Bitboard bbAttackTable[makeMagics(bbTables, nullptr).attackTableSize];
+	inline constexpr MagicTables mMagics = makeMagics(bbTables, bbAttackTable);
+	inline constexpr const Magic(&mRookMagics)[SQUARE_CNT] = mMagics.rook;
+	inline constexpr const Magic(&mBishopMagics)[SQUARE_CNT] = mMagics.bishop;
 	extern Key ZobristPSQ[COLOR_CNT][PIECETYPE_CNT][SQUARE_CNT];
 	extern Key ZobristCR[CR_BLACK_OOO + 1]; // valid only for 'singular' castling rights
 	extern Key ZobristEP[FILE_CNT];
 	extern Key ZobristBlackSide;
+	extern bool bbInitialized; // Whether initBB was called
+	extern bool bbUsePext; // Whether sliding attacks table is indexed with PEXT instead of magics
 
 	//============================================================
 	// Functions
@@ -72,19 +360,16 @@ namespace BlendXChess
 	void initZobrist(void);
 	// Converts given bitboard to string
 	std::string bbToStr(Bitboard bb);
-	// Count set bits in given bitboard
-	int countSet(Bitboard);
-	// Get least significant bit of a bitboard
-	Square getLSB(Bitboard);
-	// Get least significant bit of a bitboard and clear it
-	Square popLSB(Bitboard&);
 	// Computes bitboard of attacks from given square on 4 given directions with given relative occupancy
-	Bitboard lineAttacks(Square, Bitboard, Square[4]);
-	// Initialization of global bitboards
+	Bitboard lineAttacks(Square, Bitboard, const Square[4]);
+	// Whether CPU has PEXT instruction (if parameter is true, it should also be fast)
+	bool cpuHasPext(bool fastOnly);
+	// Fills the table of sliding attacks for given indexing (PEXT one is used only if CPU has it)
+	void initSliderAttacks(bool usePext);
+	// Fills the table of sliding attacks, using PEXT if CPU has fast one
 	void initBB(void);
-	// Initialization of magics bitboards for rooks and bishops(piece is determined by parameters)
-	void initMagics(const Square[4], const Bitboard[], const Bitboard[],
-		int8_t(Square::*)() const, int8_t(Square::*)() const, Magic[SQUARE_CNT]);
+	// Self-check of fixed tables and magic attacks against lineAttacks
+	bool verifyBB(void);
 
 	//============================================================
 	// Inline functions
@@ -95,18 +380,104 @@ namespace BlendXChess
 	{
 		return !(bb & (bb - 1));
 	}
-	// Gets magic rook moves
+	// Extracts bits of bitboard under the mask to the lowest ones (BMI2 PEXT instruction)
+#if !defined BB_PEXT || BB_PEXT
+	inline uint64_t pext(Bitboard bb, Bitboard mask)
+	{
+#if defined _MSC_VER || defined __BMI2__
+		return _pext_u64(bb, mask);
+#else // Compiler doesn't target BMI2, but the instruction is only executed if CPU has it
+		uint64_t res;
+		asm("pextq %2, %1, %0" : "=r"(res) : "r"(bb), "rm"(mask));
+		return res;
+#endif
+	}
+#endif
+
+	// Index of sliding piece's attacks in its part of sliding attacks table
+	inline size_t sliderIndex(const Magic& magic, Bitboard occupancy)
+	{
+#if !defined BB_PEXT || BB_PEXT
+		if (BB_PEXT_ALWAYS || (BB_PEXT_DISPATCH && bbUsePext))
+			return pext(occupancy, magic.relOcc);
+#endif
+		return ((magic.relOcc & occupancy) * magic.mul) >> magic.shifts;
+	}
+
+	// Reverses order of bytes (ie ranks) of bitboard
+	inline Bitboard byteSwap(Bitboard bb)
+	{
+#if defined _MSC_VER
+		return _byteswap_uint64(bb);
+#else
+		return __builtin_bswap64(bb);
+#endif
+	}
+
+	// Attacks along given file, diagonal or antidiagonal (mask shouldn't include
+	// from square) computed by hyperbola quintessence (for compact mode)
+	inline Bitboard hqAttacks(Square from, Bitboard occupancy, Bitboard lineMask)
+	{
+		Bitboard forward = occupancy & lineMask, reverse = byteSwap(forward);
+		forward -= bbSquare[from];
+		reverse -= byteSwap(bbSquare[from]);
+		return (forward ^ byteSwap(reverse)) & lineMask;
+	}
+
+	// Gets magic rook moves (or computed ones in compact mode)
 	inline Bitboard magicRookAttacks(Square from, Bitboard occupancy)
 	{
-		return mRookMagics[from].attack[((mRookMagics[from].relOcc & occupancy)
-			* mRookMagics[from].mul) >> mRookMagics[from].shifts];
+		if constexpr (BB_COMPACT_MODE)
+			return hqAttacks(from, occupancy, bbFile[from.file()] ^ bbSquare[from])
+				| Bitboard(bbFirstRankAttacks[from.file()][(occupancy >> (from.rank() * 8 + 1)) & 63])
+				<< (from.rank() * 8);
+		else
+			return mRookMagics[from].attack[sliderIndex(mRookMagics[from], occupancy)];
 	}
 
-	// Gets magic bishop moves
+	// Gets magic bishop moves (or computed ones in compact mode)
 	inline Bitboard magicBishopAttacks(Square from, Bitboard occupancy)
 	{
-		return mBishopMagics[from].attack[((mBishopMagics[from].relOcc & occupancy)
-			* mBishopMagics[from].mul) >> mBishopMagics[from].shifts];
+		if constexpr (BB_COMPACT_MODE)
+			return hqAttacks(from, occupancy, bbDiagonal[from.diagonal()] ^ bbSquare[from])
+				| hqAttacks(from, occupancy, bbAntidiagonal[from.antidiagonal()] ^ bbSquare[from]);
+		else
+			return mBishopMagics[from].attack[sliderIndex(mBishopMagics[from], occupancy)];
+	}
+
+	// Squares between two given ones (empty if they are not aligned)
+	inline Bitboard betweenBB(Square sq1, Square sq2)
+	{
+		if constexpr (BB_COMPACT_MODE)
+		{
+			// Line from b2-g7, h1-b7, b1-g1 or a2-a7 which goes in direction from sq1 to sq2 (if
+			// there is one) is shifted to start after the lower square by multiplying by it
+			const Bitboard between = (~Bitboard(0) << sq1) ^ (~Bitboard(0) << sq2);
+			const Bitboard fileDiff = Bitboard(int64_t((sq2 & 7) - (sq1 & 7)));
+			const Bitboard rankDiff = Bitboard(int64_t(((sq2 | 7) - sq1) >> 3));
+			Bitboard line = ((fileDiff & 7) - 1) & 0x0001010101010100ULL;
+			line += 2 * (((rankDiff & 7) - 1) >> 58);
+			line += (((rankDiff - fileDiff) & 15) - 1) & 0x0040201008040200ULL;
+			line += (((rankDiff + fileDiff) & 15) - 1) & 0x0002040810204080ULL;
+			return line * (between & (0 - between)) & between;
+		}
+		else
+			return bbBetween[sq1][sq2];
+	}
+
+	// Whole line through two given squares (empty if they are not aligned)
+	inline Bitboard lineBB(Square sq1, Square sq2)
+	{
+		if constexpr (BB_COMPACT_MODE)
+		{
+			const Bitboard sq2BB = sq1 == sq2 ? 0 : bbSquare[sq2];
+			const Bitboard lines[4] = { bbRank[sq1.rank()], bbFile[sq1.file()],
+				bbDiagonal[sq1.diagonal()], bbAntidiagonal[sq1.antidiagonal()] };
+			return (lines[0] & sq2BB ? lines[0] : 0) | (lines[1] & sq2BB ? lines[1] : 0)
+				| (lines[2] & sq2BB ? lines[2] : 0) | (lines[3] & sq2BB ? lines[3] : 0);
+		}
+		else
+			return bbLine[sq1][sq2];
 	}
 
 	// Shifts a bitboard in a direction specified by one of the D_ constants
@@ -59,6 +59,16 @@ void Game::reset(void)
 	gameState = GameState::ACTIVE;
 }
 
+//============================================================
+// Reset game and forget search knowledge (history
+// tables) collected during previous one
+//============================================================
+void Game::newGame(void)
+{
+	reset();
+	searcher.clearHistory();
+}
+
 //============================================================
 // Whether position is draw by insufficient material
 //============================================================
@@ -199,23 +209,49 @@ bool Game::UndoMove(void)
 void Game::setOption(std::string name, const std::string& value)
 {
 	// options.set(name, value);
-	std::transform(name.begin(), name.end(), name.begin(), std::tolower);
+	name = toLowerCase(name);
 	if (name == "timelimit")
 		searcher.setTimeLimit(convertTo<unsigned int>(value));
 	else if (name == "threadcount")
 		searcher.setThreadCount(convertTo<unsigned int>(value));
 	else if (name == "searchdepth" || name == "depth")
 		searcher.setDepth(convertTo<Depth>(value));
+	else if (name == "moveoverhead")
+		searcher.setMoveOverhead(convertTo<TimeMs>(value));
+	else if (name == "smpmode")
+	{
+		const std::string mode = toLowerCase(value);
+		if (mode == "lazy")
+			searcher.setSMPMode(SMPMode::LAZY);
+		else if (mode == "ybwc")
+			searcher.setSMPMode(SMPMode::YBWC);
+		else
+			throw std::runtime_error("Unrecognized SMP mode '" + value + "'");
+	}
+	else if (name == "smpdepthskipping")
+		searcher.setSMPDepthSkipping(convertTo<bool>(value));
+	else if (name == "numapinning")
+		searcher.setNumaPinning(convertTo<bool>(value));
 	else
 		throw std::runtime_error("Unrecognized option '" + name + "'");
 }
 
 //============================================================
-// Begins search on current position and using current options
+// Lowercase copy of string
+//============================================================
+std::string Game::toLowerCase(std::string str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+	return str;
+}
+
+//============================================================
+// Begins search on current position with given limits
+// (current options are used if limits are empty)
 //============================================================
-void Game::startSearch(void)
+void Game::startSearch(const SearchLimits& limits)
 {
-	searcher.startSearch(pos);
+	searcher.startSearch(pos, limits);
 }
 
 //============================================================
@@ -226,6 +262,14 @@ SearchReturn Game::endSearch(void)
 	return searcher.endSearch();
 }
 
+//============================================================
+// Starts counting time of pondering search (when expected move is played)
+//============================================================
+void Game::ponderHit(void)
+{
+	searcher.ponderHit();
+}
+
 //============================================================
 // Load game from the given stream assuming given move format
 //============================================================
@@ -17,6 +17,7 @@
 #include "position.h"
 #include "transtable.h"
 #include "search.h"
+#include "perft.h"
 
 namespace BlendXChess
 {
@@ -77,6 +78,8 @@ namespace BlendXChess
 		void clear(void);
 		// Reset game (stops search if there's any)
 		void reset(void);
+		// Reset game and forget search knowledge (history tables) collected during previous one
+		void newGame(void);
 		// Update game state
 		void updateGameState(void);
 		// Convert move from given string format
@@ -93,8 +96,9 @@ namespace BlendXChess
 		// Throws if no such option found
 		void setOption(std::string name, const std::string& value = "");
 		// Searching interface functions
-		void startSearch(void);
+		void startSearch(const SearchLimits& = SearchLimits());
 		SearchReturn endSearch(void);
+		void ponderHit(void);
 		// Load game from the given stream in SAN notation
 		void loadGame(std::istream&, MoveFormat fmt = FMT_SAN);
 		// Write game to the given stream in SAN notation
@@ -109,7 +113,12 @@ namespace BlendXChess
 		inline std::string getPositionFEN(bool = false) const;
 		// Redirections to Position class
 		template<bool MG_LEGAL = false>
-		inline int perft(Depth);
+		inline uint64_t perft(Depth);
+		template<bool MG_LEGAL = false>
+		inline std::vector<std::pair<Move, uint64_t>> perftDivide(Depth);
+		// Perft divide split between given number of threads, possibly with
+		// a hash table of given size in megabytes (not used if it is 0)
+		inline std::vector<std::pair<Move, uint64_t>> parallelPerftDivide(Depth, int, size_t = 0);
 	protected:
 		// Struct for storing game history information
 		struct GHRecord
@@ -122,9 +131,11 @@ namespace BlendXChess
 			// is easier than retrieve it when needed in writeGame method)
 			std::array<std::string, MOVE_FORMAT_CNT> moveStr;
 		};
-		// Convert string to number
+		// Convert string to number (or to bool, which is given as 'true'/'false' or 1/0)
 		template<typename T>
 		static inline T convertTo(const std::string&);
+		// Lowercase copy of string (option names and values are case-insensitive)
+		static std::string toLowerCase(std::string);
 		// Whether position is draw by insufficient material
 		bool drawByMaterial(void) const;
 		// Whether position is threefold repeated
@@ -217,17 +228,42 @@ namespace BlendXChess
 	}
 
 	template<bool MG_LEGAL>
-	inline int Game::perft(Depth depth)
+	inline uint64_t Game::perft(Depth depth)
 	{
 		if (isInSearch())
 			return 0;
 		return pos.perft<MG_LEGAL>(depth);
 	}
 
+	template<bool MG_LEGAL>
+	inline std::vector<std::pair<Move, uint64_t>> Game::perftDivide(Depth depth)
+	{
+		if (isInSearch())
+			return {};
+		return pos.perftDivide<MG_LEGAL>(depth);
+	}
+
+	inline std::vector<std::pair<Move, uint64_t>> Game::parallelPerftDivide(
+		Depth depth, int threadCount, size_t hashSizeMB)
+	{
+		if (isInSearch())
+			return {};
+		return ParallelPerft(threadCount, hashSizeMB).divide(pos, depth);
+	}
+
 	template<typename T>
 	inline T Game::convertTo(const std::string& str)
 	{
 		static_assert(std::is_arithmetic_v<T>, "'T' should be numeric type");
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			const std::string flag = toLowerCase(str);
+			if (flag == "true" || flag == "1")
+				return true;
+			if (flag == "false" || flag == "0")
+				return false;
+			throw std::runtime_error(str + " is not 'true' or 'false'");
+		}
 		try
 		{
 			if constexpr (std::is_unsigned_v<T>)
@@ -13,7 +13,8 @@ using namespace BlendXChess;
 //============================================================
 template<bool ROOT>
 MoveManager<ROOT>::MoveManager(Searcher& searcher, Move ttMove)
-	: searcher(searcher), ttMove(ttMove), state(MMState::TT_MOVE)
+	: searcher(searcher), ttMove(ROOT ? MOVE_NONE : ttMove),
+	state(ROOT ? MMState::GENMOVES : MMState::TT_MOVE)
 {}
 
 //============================================================
@@ -42,13 +43,7 @@ Move MoveManager<ROOT>::next(void)
 			assert(foundTT);
 			moveList.clear();
 #endif
-			if constexpr (ROOT)
-			{
-				if (pos.isLegal(ttMove))
-					return ttMove;
-			}
-			else
-				return ttMove;
+			return ttMove;
 		}
 #ifdef ENGINE_DEBUG
 		else
@@ -65,33 +60,26 @@ Move MoveManager<ROOT>::next(void)
 			moveList.clear();
 		}
 #endif
-		// [[fallthrough]] // if ttMove is inappropriate, we should proceed
+		[[fallthrough]]; // if ttMove is inappropriate, we should proceed
 	case MMState::GENMOVES:
-		if constexpr (ROOT)
-			pos.generateLegalMoves(moveList);
-		else
-			pos.generatePseudolegalMoves(moveList);
-		searcher.scoreMoves(moveList);
+		generateMoves();
 		state = MMState::GENERATED;
-		// [[fallthrough]]
+		[[fallthrough]];
 	case MMState::GENERATED:
 		nextMove = moveList.getNextBest();
 		if (nextMove == ttMove)
 			nextMove = moveList.getNextBest();
-		if constexpr (ROOT)
-		{
-			if (nextMove == MOVE_NONE)
-				state = MMState::DEFERRED;
-			else
-				return nextMove;
-		}
-		else
+		if (nextMove != MOVE_NONE)
 			return nextMove;
-		// [[fallthrough]] // we should proceed if we are to return deferred moves from root chess
+		state = MMState::DEFERRED;
+		[[fallthrough]]; // we should proceed to return deferred moves
 	case MMState::DEFERRED:
-		assert(ROOT); // Deferred moves are only for root search (currently)
+		// ttMove can't be deferred, so no check for that
 		if constexpr (ROOT)
-			return deferredList.getNext(); // ttMove can't be deferred, so no check for that
+			return this->deferredList.getNext();
+		else
+			return this->deferredIdx < this->deferredCnt
+				? this->deferredMoves[this->deferredIdx++] : MOVE_NONE;
 	default:
 		assert(false); // Should not occur
 	}
@@ -99,14 +87,57 @@ Move MoveManager<ROOT>::next(void)
 }
 
 //============================================================
-// Defers moves that needs to be searched later in root search
+// Generates and scores moves
+//============================================================
+template<bool ROOT>
+void MoveManager<ROOT>::generateMoves(void)
+{
+	// Root moves are already generated legal and ordered by previous iterations
+	if constexpr (ROOT)
+	{
+		const RootMoves& rootMoves = searcher.rootMoves;
+		for (size_t moveIdx = 0; moveIdx < rootMoves.size(); ++moveIdx)
+			moveList.add(rootMoves[moveIdx].move, MoveScore(rootMoves.size() - moveIdx));
+	}
+	else
+	{
+		searcher.pos.generatePseudolegalMoves(moveList);
+		searcher.scoreMoves(moveList);
+	}
+}
+
+//============================================================
+// Generates remaining moves in advance, so that next() doesn't access
+// the position afterwards (TT move should be already returned)
+//============================================================
+template<bool ROOT>
+void MoveManager<ROOT>::generateRemaining(void)
+{
+	assert(state != MMState::TT_MOVE);
+	if (state == MMState::GENMOVES)
+	{
+		generateMoves();
+		state = MMState::GENERATED;
+	}
+}
+
+//============================================================
+// Defers move that needs to be searched after all others
+// Returns false if it can't be deferred (so it should be searched now)
 //============================================================
 template<bool ROOT>
-void BlendXChess::MoveManager<ROOT>::defer(Move move)
+bool BlendXChess::MoveManager<ROOT>::defer(Move move)
 {
-	assert(ROOT);
+	assert(state != MMState::DEFERRED);
 	if constexpr (ROOT)
-		deferredList.add(move, MS_DEFERRED);
+		this->deferredList.add(move, MS_DEFERRED);
+	else
+	{
+		if (this->deferredCnt == this->MAX_DEFERRED_CNT)
+			return false;
+		this->deferredMoves[this->deferredCnt++] = move;
+	}
+	return true;
 }
 
 //============================================================
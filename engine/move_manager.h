@@ -24,9 +24,15 @@ namespace BlendXChess
 	// Class for ordered selection of (pseudo-)legal moves during search
 	//============================================================
 
+	// Interior nodes defer only few moves (ones currently searched by other threads)
 	template<bool ROOT>
 	class DeferredMember
-	{};
+	{
+	protected:
+		static constexpr int MAX_DEFERRED_CNT = 32;
+		Move deferredMoves[MAX_DEFERRED_CNT];
+		int deferredCnt = 0, deferredIdx = 0;
+	};
 
 	template<>
 	class DeferredMember<true>
@@ -45,9 +51,15 @@ namespace BlendXChess
 		inline bool lastMoveDeferred(void) const noexcept;
 		// Returns next picked move or MOVE_NONE if none left
 		Move next(void);
-		// Defers moves that needs to be searched later in root search
-		void defer(Move);
+		// Defers move that needs to be searched after all others
+		// Returns false if it can't be deferred (so it should be searched now)
+		bool defer(Move);
+		// Generates remaining moves in advance, so that next() doesn't access the position
+		// afterwards (needed when the manager is shared by threads of a split point)
+		void generateRemaining(void);
 	private:
+		// Generates and scores moves
+		void generateMoves(void);
 		Searcher& searcher;
 		MMState state;
 		Move ttMove;
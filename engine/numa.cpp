@@ -0,0 +1,182 @@
+//============================================================
+// numa.cpp
+// BlendXChess
+//============================================================
+
+#include "numa.h"
+#ifdef __linux__
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace BlendXChess
+{
+
+#ifdef __linux__
+	// Constants of mbind system call (from linux/mempolicy.h, so that libnuma isn't needed)
+	constexpr int MPOL_DEFAULT_POLICY = 0;
+	constexpr int MPOL_INTERLEAVE_POLICY = 3;
+	constexpr unsigned int MPOL_MF_MOVE_FLAG = 1 << 1;
+	constexpr int NODE_MASK_WORDS = 16; // Up to 1024 nodes
+	constexpr int NODE_MASK_BITS = NODE_MASK_WORDS * 8 * sizeof(unsigned long);
+
+	//============================================================
+	// Parses list of CPUs in sysfs format (like "0-7,16-23")
+	//============================================================
+	static std::vector<int> parseCPUList(const std::string& list)
+	{
+		std::vector<int> cpus;
+		std::istringstream iss(list);
+		std::string range;
+		while (std::getline(iss, range, ','))
+		{
+			if (range.empty() || range == "\n")
+				continue;
+			const size_t dash = range.find('-');
+			const int first = std::stoi(range.substr(0, dash));
+			const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		}
+		return cpus;
+	}
+
+	//============================================================
+	// Gets bounds of whole pages inside given memory region. Returns whether there are any
+	//============================================================
+	static bool wholePages(void* ptr, size_t size, uintptr_t& begin, uintptr_t& end)
+	{
+		const uintptr_t pageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+		begin = (uintptr_t(ptr) + pageSize - 1) & ~(pageSize - 1);
+		end = (uintptr_t(ptr) + size) & ~(pageSize - 1);
+		return begin < end;
+	}
+#endif
+
+	//============================================================
+	// Discovers topology (single node if it fails)
+	//============================================================
+	NumaTopology::NumaTopology(void)
+	{
+#ifdef __linux__
+		try
+		{
+			namespace fs = std::filesystem;
+			std::vector<std::pair<int, std::vector<int>>> nodes;
+			for (const fs::directory_entry& entry : fs::directory_iterator("/sys/devices/system/node"))
+			{
+				const std::string name = entry.path().filename().string();
+				if (name.compare(0, 4, "node") != 0 || name.size() == 4
+					|| !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+					continue;
+				std::ifstream cpuList(entry.path() / "cpulist");
+				std::string list;
+				if (!std::getline(cpuList, list))
+					continue;
+				std::vector<int> cpus = parseCPUList(list);
+				// Memory-only nodes don't run threads
+				if (!cpus.empty() && std::stoi(name.substr(4)) < NODE_MASK_BITS)
+					nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+			}
+			std::sort(nodes.begin(), nodes.end());
+			for (auto& [nodeID, cpus] : nodes)
+			{
+				nodeIDs.push_back(nodeID);
+				nodeCPUs.push_back(std::move(cpus));
+			}
+		}
+		catch (const std::exception&)
+		{
+			nodeIDs.clear();
+			nodeCPUs.clear();
+		}
+#endif
+		if (nodeCPUs.empty())
+		{
+			nodeIDs.assign(1, 0);
+			nodeCPUs.assign(1, std::vector<int>());
+		}
+	}
+
+	//============================================================
+	// Topology of this machine (discovered on the first call)
+	//============================================================
+	const NumaTopology& NumaTopology::get(void)
+	{
+		static const NumaTopology topology;
+		return topology;
+	}
+
+	//============================================================
+	// Binds calling thread to CPUs of given node. Returns whether succeeded
+	//============================================================
+	bool NumaTopology::bindThread(int node) const
+	{
+#ifdef __linux__
+		const std::vector<int>& cpus = nodeCPUs[node];
+		if (cpus.empty())
+			return false;
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		for (int cpu : cpus)
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &cpuSet);
+		return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+		(void)node;
+		return false;
+#endif
+	}
+
+	//============================================================
+	// Moves pages of given memory region to all nodes in turn
+	// (interleaved policy). Only whole pages inside it are affected
+	//============================================================
+	bool NumaTopology::interleave(void* ptr, size_t size) const
+	{
+#ifdef __linux__
+		if (nodeCount() < 2)
+			return false;
+		uintptr_t begin, end;
+		if (!wholePages(ptr, size, begin, end))
+			return false;
+		unsigned long nodeMask[NODE_MASK_WORDS] = {};
+		constexpr int WORD_BITS = 8 * sizeof(unsigned long);
+		for (int nodeID : nodeIDs)
+			nodeMask[nodeID / WORD_BITS] |= 1UL << (nodeID % WORD_BITS);
+		// Kernel treats maxnode as one more than the count of mask bits
+		return syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE_POLICY,
+			nodeMask, NODE_MASK_BITS + 1, MPOL_MF_MOVE_FLAG) == 0;
+#else
+		(void)ptr, (void)size;
+		return false;
+#endif
+	}
+
+	//============================================================
+	// Resets memory policy of given region to the default one
+	// Only whole pages inside it are affected
+	//============================================================
+	bool NumaTopology::resetMemoryPolicy(void* ptr, size_t size) const
+	{
+#ifdef __linux__
+		if (nodeCount() < 2)
+			return false;
+		uintptr_t begin, end;
+		if (!wholePages(ptr, size, begin, end))
+			return false;
+		return syscall(SYS_mbind, begin, end - begin, MPOL_DEFAULT_POLICY, nullptr, 0, 0) == 0;
+#else
+		(void)ptr, (void)size;
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,61 @@
+//============================================================
+// numa.h
+// BlendXChess
+//============================================================
+
+#pragma once
+#ifndef _NUMA_H
+#define _NUMA_H
+#include <vector>
+#include <cstddef>
+
+namespace BlendXChess
+{
+
+	//============================================================
+	// NUMA topology of the machine, discovered from /sys/devices/system/node
+	// Elsewhere than on Linux (or if discovery fails) there is a single node
+	// with unknown CPUs, so threads are never pinned and memory isn't moved
+	//============================================================
+
+	class NumaTopology
+	{
+	public:
+		// Topology of this machine (discovered on the first call)
+		static const NumaTopology& get(void);
+		// Count of nodes
+		inline int nodeCount(void) const noexcept;
+		// Node which search thread with given index is bound to (threads are spread round-robin)
+		inline int nodeOfThread(int threadID) const noexcept;
+		// Binds calling thread to CPUs of given node. Returns whether succeeded
+		bool bindThread(int node) const;
+		// Moves pages of given memory region to all nodes in turn (interleaved policy),
+		// so that no node serves all accesses to it. Returns whether succeeded
+		bool interleave(void* ptr, size_t size) const;
+		// Resets memory policy of given region to the default one (pages which are already
+		// placed aren't moved back, but new ones are allocated locally). Returns whether succeeded
+		bool resetMemoryPolicy(void* ptr, size_t size) const;
+	private:
+		NumaTopology(void);
+		// Node numbers as in sysfs (they may be sparse)
+		std::vector<int> nodeIDs;
+		// CPUs of each node
+		std::vector<std::vector<int>> nodeCPUs;
+	};
+
+	//============================================================
+	// Implementation of inline functions
+	//============================================================
+
+	inline int NumaTopology::nodeCount(void) const noexcept
+	{
+		return int(nodeCPUs.size());
+	}
+
+	inline int NumaTopology::nodeOfThread(int threadID) const noexcept
+	{
+		return threadID % nodeCount();
+	}
+}
+
+#endif
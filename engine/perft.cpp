@@ -0,0 +1,150 @@
+//============================================================
+// perft.cpp
+// BlendXChess
+//============================================================
+
+#include "perft.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace BlendXChess
+{
+
+	//============================================================
+	// Constructor (size is in megabytes, entry count is rounded down to a power of two)
+	//============================================================
+	PerftTable::PerftTable(size_t sizeMB)
+	{
+		// Sizes are compared in entries, so that nothing overflows for any given size
+		constexpr size_t ENTRIES_PER_MB = 1024 * 1024 / sizeof(Entry);
+		const size_t maxEntryCount = sizeMB > SIZE_MAX / ENTRIES_PER_MB ? SIZE_MAX : sizeMB * ENTRIES_PER_MB;
+		size_t entryCount = 1;
+		while (entryCount <= maxEntryCount / 2)
+			entryCount *= 2;
+		try
+		{
+			entries = std::make_unique<Entry[]>(entryCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			throw std::runtime_error("Can't allocate perft hash table of " + std::to_string(sizeMB) + " MB");
+		}
+		for (size_t idx = 0; idx < entryCount; ++idx)
+		{
+			// Zero key with zero data would verify, so empty entry has data 1, ie zero count at
+			// depth 1. That never matches, since depth 1 isn't probed (leaves are counted in bulk)
+			entries[idx].data.store(1, std::memory_order_relaxed);
+			entries[idx].keyXorData.store(0, std::memory_order_relaxed);
+		}
+		indexMask = entryCount - 1;
+	}
+
+	//============================================================
+	// Constructor (hash table is not used if its size is 0)
+	//============================================================
+	ParallelPerft::ParallelPerft(int threadCount, size_t hashSizeMB)
+		: threadCount(std::clamp(threadCount, 1, int(std::max(std::thread::hardware_concurrency(), 1u)))),
+		table(hashSizeMB ? std::make_unique<PerftTable>(std::min(hashSizeMB, PERFT_HASH_SIZE_MAX)) : nullptr)
+	{}
+
+	//============================================================
+	// Returns leaf count of each root move of given position
+	//============================================================
+	std::vector<std::pair<Move, uint64_t>> ParallelPerft::divide(const Position& rootPos, Depth depth)
+	{
+		std::vector<std::pair<Move, uint64_t>> rootMoveNodes;
+		if (depth == 0)
+			return rootMoveNodes;
+		Position pos = rootPos;
+		MoveList rootMoves;
+		pos.generateLegalMovesEx(rootMoves);
+		for (int moveIdx = 0; moveIdx < rootMoves.count(); ++moveIdx)
+			rootMoveNodes.emplace_back(rootMoves[moveIdx].move, depth == 1 ? 1 : 0);
+		if (depth == 1)
+			return rootMoveNodes;
+		// Work item is a root move with one of its replies (there are few
+		// hundreds of them, which is enough to balance the load of threads)
+		struct WorkItem
+		{
+			int rootIdx;
+			Move reply;
+		};
+		std::vector<WorkItem> workItems;
+		PositionInfo prevState;
+		for (int rootIdx = 0; rootIdx < rootMoves.count(); ++rootIdx)
+		{
+			const Move move = rootMoves[rootIdx].move;
+			MoveList replies;
+			pos.doMove(move, prevState);
+			pos.generateLegalMovesEx(replies);
+			pos.undoMove(move, prevState);
+			for (int replyIdx = 0; replyIdx < replies.count(); ++replyIdx)
+				workItems.push_back({ rootIdx, replies[replyIdx].move });
+		}
+		// Each thread counts nodes of root moves separately, they are summed after all threads finish
+		std::atomic<size_t> nextItem = 0;
+		std::vector<std::vector<uint64_t>> threadNodes(threadCount,
+			std::vector<uint64_t>(rootMoves.count(), 0));
+		auto work = [&](int threadID) {
+			Position threadPos = rootPos;
+			PositionInfo rootState, replyState;
+			for (size_t itemIdx; (itemIdx = nextItem++) < workItems.size(); )
+			{
+				const WorkItem& item = workItems[itemIdx];
+				const Move move = rootMoves[item.rootIdx].move;
+				threadPos.doMove(move, rootState);
+				threadPos.doMove(item.reply, replyState);
+				threadNodes[threadID][item.rootIdx] += perft(threadPos, depth - 2);
+				threadPos.undoMove(item.reply, replyState);
+				threadPos.undoMove(move, rootState);
+			}
+		};
+		// If a thread can't be started, work is just shared by fewer threads
+		std::vector<std::thread> threads;
+		try
+		{
+			for (int threadID = 1; threadID < threadCount; ++threadID)
+				threads.emplace_back(work, threadID);
+		}
+		catch (const std::system_error&)
+		{}
+		work(0);
+		for (std::thread& thread : threads)
+			thread.join();
+		for (const std::vector<uint64_t>& nodes : threadNodes)
+			for (size_t rootIdx = 0; rootIdx < rootMoveNodes.size(); ++rootIdx)
+				rootMoveNodes[rootIdx].second += nodes[rootIdx];
+		return rootMoveNodes;
+	}
+
+	//============================================================
+	// Serial perft which uses hash table if there is one
+	//============================================================
+	uint64_t ParallelPerft::perft(Position& pos, Depth depth)
+	{
+		if (depth == 0)
+			return 1;
+		uint64_t nodes = 0;
+		// At depth 1 leaves are counted in bulk, which is cheaper than probing
+		if (depth > 1 && table && table->probe(pos.getZobristKey(), depth, nodes))
+			return nodes;
+		MoveList moveList;
+		pos.generateLegalMovesEx(moveList);
+		if (depth == 1)
+			return moveList.count();
+		PositionInfo prevState;
+		for (int moveIdx = 0; moveIdx < moveList.count(); ++moveIdx)
+		{
+			const Move move = moveList[moveIdx].move;
+			pos.doMove(move, prevState);
+			nodes += perft(pos, depth - 1);
+			pos.undoMove(move, prevState);
+		}
+		if (table)
+			table->store(pos.getZobristKey(), depth, nodes);
+		return nodes;
+	}
+}
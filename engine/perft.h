@@ -0,0 +1,90 @@
+//============================================================
+// perft.h
+// BlendXChess
+//============================================================
+
+#pragma once
+#ifndef _PERFT_H
+#define _PERFT_H
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "position.h"
+
+namespace BlendXChess
+{
+
+	// Maximum size of perft hash table in megabytes (bigger sizes are clamped)
+	constexpr size_t PERFT_HASH_SIZE_MAX = 32768;
+
+	//============================================================
+	// Lock-free hash table of perft leaf counts, keyed by position and depth
+	// Entry is stored as two words, one of which is XOR-ed with the key, so that
+	// entry torn by concurrent writes fails verification instead of giving wrong count
+	//============================================================
+
+	class PerftTable
+	{
+	public:
+		// Constructor (size is in megabytes, entry count is rounded down to a power of two)
+		// Throws std::runtime_error if the table can't be allocated
+		explicit PerftTable(size_t sizeMB);
+		// Returns whether leaf count for given position key and depth is found and writes it to the last parameter
+		inline bool probe(Key, Depth, uint64_t&) const;
+		// Stores leaf count for given position key and depth (always replaces)
+		inline void store(Key, Depth, uint64_t);
+	private:
+		struct Entry
+		{
+			std::atomic<uint64_t> keyXorData;
+			std::atomic<uint64_t> data; // Leaf count in upper 56 bits and depth in lower 8 ones
+		};
+		std::unique_ptr<Entry[]> entries;
+		size_t indexMask;
+	};
+
+	//============================================================
+	// Perft which splits work between threads. They take root moves (together with
+	// replies to them, so that there are enough work items for all threads) from
+	// a shared queue. Moves are generated like in Position::perft<true>
+	//============================================================
+
+	class ParallelPerft
+	{
+	public:
+		// Constructor (hash table is not used if its size is 0). Thread count is clamped
+		// to hardware concurrency and hash size to PERFT_HASH_SIZE_MAX
+		ParallelPerft(int threadCount, size_t hashSizeMB = 0);
+		// Returns leaf count of each root move of given position
+		std::vector<std::pair<Move, uint64_t>> divide(const Position&, Depth);
+	private:
+		// Serial perft which uses hash table if there is one
+		uint64_t perft(Position&, Depth);
+		int threadCount;
+		std::unique_ptr<PerftTable> table;
+	};
+
+	//============================================================
+	// Implementation of inline functions
+	//============================================================
+
+	inline bool PerftTable::probe(Key key, Depth depth, uint64_t& nodes) const
+	{
+		const Entry& entry = entries[key & indexMask];
+		const uint64_t data = entry.data.load(std::memory_order_relaxed);
+		if ((entry.keyXorData.load(std::memory_order_relaxed) ^ data) != key || Depth(data & 0xff) != depth)
+			return false;
+		nodes = data >> 8;
+		return true;
+	}
+
+	inline void PerftTable::store(Key key, Depth depth, uint64_t nodes)
+	{
+		Entry& entry = entries[key & indexMask];
+		const uint64_t data = (nodes << 8) | uint8_t(depth);
+		entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+		entry.data.store(data, std::memory_order_relaxed);
+	}
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <string>
 #include <sstream>
+#include <cctype>
 
 using namespace BlendXChess;
 
@@ -15,7 +16,12 @@ using namespace BlendXChess;
 //============================================================
 Position::Position(void)
 {
-	reset();
+	// Position may be constructed before bitboards are initialized (eg as a member
+	// of global Game object), then it is left cleared until it is reset explicitly
+	if (bbInitialized)
+		reset();
+	else
+		clear();
 }
 
 //============================================================
@@ -44,6 +50,8 @@ void Position::clear(void)
 	info.justCaptured = PT_NULL;
 	info.epSquare = Sq::NONE;
 	info.castlingRight = CR_NULL;
+	info.checkers = 0;
+	info.blockers = 0;
 	// Clear bitboards
 	for (Side c = 0; c < COLOR_CNT; ++c)
 		colorBB[c] = 0;
@@ -98,41 +106,87 @@ void Position::reset(void)
 	info.keyZobrist ^=
 		ZobristCR[CR_WHITE_OO] ^ ZobristCR[CR_WHITE_OOO] ^
 		ZobristCR[CR_BLACK_OO] ^ ZobristCR[CR_BLACK_OOO];
+	updateCheckInfo();
 }
 
 //============================================================
-// Performance test (if MG_LEGAL is true, all moves are tested for legality
-// during generation and promotions to bishops and rooks are included)
+// Computes check information of info for current position
+//============================================================
+void Position::updateCheckInfo(void)
+{
+	info.checkers = allAttackers(pieceSq[turn][KING][0], opposite(turn));
+	info.blockers = sliderBlockers(turn);
+}
+
+//============================================================
+// Performance test (if MG_LEGAL is true, moves are generated legal and
+// promotions to bishops and rooks are included, otherwise pseudolegal
+// moves are generated and filtered by isLegal, like it's done in search)
+// Leaves are counted in bulk, so that last ply's moves aren't performed
 //============================================================
 template<bool MG_LEGAL>
-int Position::perft(Depth depth)
+uint64_t Position::perft(Depth depth)
 {
 	if (depth == 0)
 		return 1;
-	int nodes(0);
+	uint64_t nodes = 0;
 	Move move;
 	MoveList moveList;
 	PositionInfo prevState;
 	if constexpr (MG_LEGAL)
+	{
 		generateLegalMovesEx(moveList);
+		if (depth == 1)
+			return moveList.count();
+	}
 	else
 		generatePseudolegalMoves(moveList);
 	for (int moveIdx = 0; moveIdx < moveList.count(); ++moveIdx)
 	{
 		move = moveList[moveIdx].move;
-		doMove(move, prevState);
 		if constexpr (!MG_LEGAL)
-			if (isAttacked(pieceSq[opposite(turn)][KING][0], turn))
-			{
-				undoMove(move, prevState);
+			if (!isLegal(move))
 				continue;
-			}
+		if (depth == 1)
+		{
+			++nodes;
+			continue;
+		}
+		doMove(move, prevState);
 		nodes += perft<MG_LEGAL>(depth - 1);
 		undoMove(move, prevState);
 	}
 	return nodes;
 }
 
+//============================================================
+// Performance test which returns leaf count of each root move separately
+//============================================================
+template<bool MG_LEGAL>
+std::vector<std::pair<Move, uint64_t>> Position::perftDivide(Depth depth)
+{
+	std::vector<std::pair<Move, uint64_t>> rootMoveNodes;
+	if (depth == 0)
+		return rootMoveNodes;
+	MoveList moveList;
+	PositionInfo prevState;
+	if constexpr (MG_LEGAL)
+		generateLegalMovesEx(moveList);
+	else
+		generatePseudolegalMoves(moveList);
+	for (int moveIdx = 0; moveIdx < moveList.count(); ++moveIdx)
+	{
+		const Move move = moveList[moveIdx].move;
+		if constexpr (!MG_LEGAL)
+			if (!isLegal(move))
+				continue;
+		doMove(move, prevState);
+		rootMoveNodes.emplace_back(move, perft<MG_LEGAL>(depth - 1));
+		undoMove(move, prevState);
+	}
+	return rootMoveNodes;
+}
+
 //============================================================
 // Function for doing a move and updating all board state information
 // Performs given move if legal and updates necessary info
@@ -205,6 +259,7 @@ void Position::doMove(Move move, PositionInfo& outPrevInfo)
 	info.keyZobrist ^= ZobristBlackSide;
 	turn = opposite(turn);
 	++gamePly;
+	updateCheckInfo();
 }
 
 //============================================================
@@ -245,7 +300,7 @@ bool Position::isPseudoLegal(Move move) const
 {
 	const Square from = move.from(), to = move.to();
 	if (getPieceSide(board[from]) != turn || getPieceSide(board[to]) == turn
-		|| occupiedBB() & bbBetween[from][to])
+		|| occupiedBB() & betweenBB(from, to))
 		return false;
 	// We don't check eg whether the king is on E1/E8 square, since tested move
 	// is assumed to be previously generated for some valid position
@@ -278,7 +333,7 @@ bool Position::isPseudoLegal(Move move) const
 // Reveal PAWN moves in given direction from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
 //============================================================
 template<Side TURN, bool LEGAL>
-void Position::revealPawnMoves(Bitboard destBB, Square direction, MoveList& moves) const
+void Position::revealPawnMoves(Bitboard destBB, Square direction, MoveList& moves, Bitboard pinned) const
 {
 	static_assert(TURN == WHITE || TURN == BLACK,
 		"TURN template parameter should be either WHITE or BLACK in this function");
@@ -295,26 +350,51 @@ void Position::revealPawnMoves(Bitboard destBB, Square direction, MoveList& move
 		assert(getPieceSide(board[to]) == (direction == FORWARD ? NULL_COLOR : opposite(TURN)));
 		if (TURN == WHITE ? to > Sq::H7 : to < Sq::A2)
 			for (int promIdx = 0; promIdx < 2; ++promIdx)
-				addMoveIfSuitable<TURN, LEGAL>(Move(from, to, MT_PROMOTION, promPieceType[promIdx]), moves);
+				addMoveIfSuitable<TURN, LEGAL>(Move(from, to, MT_PROMOTION, promPieceType[promIdx]), moves, pinned);
 		else
-			addMoveIfSuitable<TURN, LEGAL>(Move(from, to), moves);
+			addMoveIfSuitable<TURN, LEGAL>(Move(from, to), moves, pinned);
+	}
+}
+
+//============================================================
+// Reveal NON-PAWN and NON-KING moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
+//============================================================
+template<Side TURN, bool LEGAL>
+void Position::revealMoves(Square from, Bitboard destBB, MoveList& moves, Bitboard pinned) const
+{
+	static_assert(TURN == WHITE || TURN == BLACK,
+		"TURN template parameter should be either WHITE or BLACK in this function");
+	assert(getPieceSide(board[from]) == TURN);
+	assert(getPieceType(board[from]) != KING);
+	// Pinned piece can only move along the pin line (so pinned knight can't move at all)
+	if constexpr (LEGAL)
+		if (pinned & bbSquare[from])
+			destBB &= lineBB(pieceSq[TURN][KING][0], from);
+	while (destBB)
+	{
+		const Square to = popLSB(destBB);
+		assert(getPieceSide(board[to]) != TURN);
+		moves.add(Move(from, to));
 	}
 }
 
 //============================================================
-// Reveal NON-PAWN moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
+// Reveal KING moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
 //============================================================
 template<Side TURN, bool LEGAL>
-void Position::revealMoves(Square from, Bitboard destBB, MoveList& moves) const
+void Position::revealKingMoves(Bitboard destBB, MoveList& moves) const
 {
 	static_assert(TURN == WHITE || TURN == BLACK,
 		"TURN template parameter should be either WHITE or BLACK in this function");
+	const Square from = pieceSq[TURN][KING][0];
+	// King is removed from occupancy, otherwise retreating along the line of checking slider would be allowed
+	const Bitboard occupancy = occupiedBB() ^ bbSquare[from];
 	while (destBB)
 	{
 		const Square to = popLSB(destBB);
-		assert(getPieceSide(board[from]) == TURN);
 		assert(getPieceSide(board[to]) != TURN);
-		addMoveIfSuitable<TURN, LEGAL>(Move(from, to), moves);
+		if (!LEGAL || !isAttacked(to, opposite(TURN), occupancy))
+			moves.add(Move(from, to));
 	}
 }
 
@@ -322,7 +402,7 @@ void Position::revealMoves(Square from, Bitboard destBB, MoveList& moves) const
 // Generate pawn moves. Only to distBB squares if MG_TYPE == MG_EVASIONS
 //============================================================
 template<Side TURN, MoveGen MG_TYPE, bool LEGAL>
-void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
+void Position::generatePawnMoves(MoveList& moves, Bitboard pinned, Bitboard destBB) const
 {
 	static_assert(TURN == WHITE || TURN == BLACK,
 		"TURN template parameter should be either WHITE or BLACK in this function");
@@ -337,16 +417,16 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 		if constexpr (MG_TYPE == MG_EVASIONS) // destBB is valid in this case
 		{
 			revealPawnMoves<TURN, LEGAL>(bbShiftD<LEFT_CAPT>(
-				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)] & destBB, LEFT_CAPT, moves);
+				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)] & destBB, LEFT_CAPT, moves, pinned);
 			revealPawnMoves<TURN, LEGAL>(bbShiftD<RIGHT_CAPT>(
-				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)] & destBB, RIGHT_CAPT, moves);
+				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)] & destBB, RIGHT_CAPT, moves, pinned);
 		}
 		else
 		{
 			revealPawnMoves<TURN, LEGAL>(bbShiftD<LEFT_CAPT>(
-				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)], LEFT_CAPT, moves);
+				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)], LEFT_CAPT, moves, pinned);
 			revealPawnMoves<TURN, LEGAL>(bbShiftD<RIGHT_CAPT>(
-				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)], RIGHT_CAPT, moves);
+				pieceBB(TURN, PAWN)) & colorBB[opposite(TURN)], RIGHT_CAPT, moves, pinned);
 		}
 		// En passant. If MG_TYPE == MG_EVASIONS, check was either not double-pawn push (so epSquare is Sq::NONE)
 		// or there is epSquare and we want to consider EP evasion (because we consider this
@@ -355,11 +435,14 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 		{
 			assert(board[info.epSquare] == PIECE_NULL && board[info.epSquare + FORWARD] == PIECE_NULL);
 			assert(board[info.epSquare - FORWARD] == makePiece(opposite(TURN), PAWN));
+			// Pins and checks don't describe all cases for en passant, so its legality is tested separately
 			Square from;
 			if (info.epSquare.file() != 7 && board[from = info.epSquare - LEFT_CAPT] == TURN_PAWN)
-				addMoveIfSuitable<TURN, LEGAL>(Move(from, info.epSquare, MT_EN_PASSANT), moves);
+				if (const Move move(from, info.epSquare, MT_EN_PASSANT); !LEGAL || isLegalEnPassant(move))
+					moves.add(move);
 			if (info.epSquare.file() != 0 && board[from = info.epSquare - RIGHT_CAPT] == TURN_PAWN)
-				addMoveIfSuitable<TURN, LEGAL>(Move(from, info.epSquare, MT_EN_PASSANT), moves);
+				if (const Move move(from, info.epSquare, MT_EN_PASSANT); !LEGAL || isLegalEnPassant(move))
+					moves.add(move);
 		}
 	}
 	if constexpr (MG_TYPE != MG_CAPTURES)
@@ -368,7 +451,7 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 		{
 			// One-step pawn forward moves (including promotions)
 			const Bitboard pawnDestBB = bbShiftD<FORWARD>(pieceBB(TURN, PAWN)) & emptyBB();
-			revealPawnMoves<TURN, LEGAL>(destBB & pawnDestBB, FORWARD, moves);
+			revealPawnMoves<TURN, LEGAL>(destBB & pawnDestBB, FORWARD, moves, pinned);
 			// Two-step pawn forward moves (here we can't promote, so don't use revealPawnMoves)
 			destBB &= bbShiftD<FORWARD>(pawnDestBB & BB_REL_RANK_3) & emptyBB();
 		}
@@ -376,7 +459,7 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 		{
 			// One-step pawn forward moves (including promotions)
 			destBB = bbShiftD<FORWARD>(pieceBB(TURN, PAWN)) & emptyBB();
-			revealPawnMoves<TURN, LEGAL>(destBB, FORWARD, moves);
+			revealPawnMoves<TURN, LEGAL>(destBB, FORWARD, moves, pinned);
 			// Two-step pawn forward moves (here we can't promote, so don't use revealPawnMoves)
 			destBB = bbShiftD<FORWARD>(destBB & BB_REL_RANK_3) & emptyBB();
 		}
@@ -385,7 +468,7 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 		{
 			const Square to = popLSB(destBB);
 			assert(getPieceSide(board[to]) == NULL_COLOR);
-			addMoveIfSuitable<TURN, LEGAL>(Move(to - (FORWARD + FORWARD), to), moves);
+			addMoveIfSuitable<TURN, LEGAL>(Move(to - (FORWARD + FORWARD), to), moves, pinned);
 		}
 	}
 }
@@ -394,36 +477,36 @@ void Position::generatePawnMoves(MoveList& moves, Bitboard destBB) const
 // Generate non-pawn and non-king moves. Only to destBB squares irrespectively of MG_TYPE
 //============================================================
 template<Side TURN, bool LEGAL>
-void Position::generateFigureMoves(MoveList& moves, Bitboard destBB) const
+void Position::generateFigureMoves(MoveList& moves, Bitboard pinned, Bitboard destBB) const
 {
 	Square from;
 	// Knight moves
 	for (int i = 0; i < pieceCount[TURN][KNIGHT]; ++i)
 	{
 		from = pieceSq[turn][KNIGHT][i];
-		revealMoves<TURN, LEGAL>(from, bbKnightAttack[from] & destBB, moves);
+		revealMoves<TURN, LEGAL>(from, bbKnightAttack[from] & destBB, moves, pinned);
 	}
 	// Rook and partially queen moves
 	for (int i = 0; i < pieceCount[TURN][ROOK]; ++i)
 	{
 		from = pieceSq[turn][ROOK][i];
-		revealMoves<TURN, LEGAL>(from, magicRookAttacks(from, occupiedBB()) & destBB, moves);
+		revealMoves<TURN, LEGAL>(from, magicRookAttacks(from, occupiedBB()) & destBB, moves, pinned);
 	}
 	for (int i = 0; i < pieceCount[TURN][QUEEN]; ++i)
 	{
 		from = pieceSq[turn][QUEEN][i];
-		revealMoves<TURN, LEGAL>(from, magicRookAttacks(from, occupiedBB()) & destBB, moves);
+		revealMoves<TURN, LEGAL>(from, magicRookAttacks(from, occupiedBB()) & destBB, moves, pinned);
 	}
 	// Bishop and partially queen moves
 	for (int i = 0; i < pieceCount[TURN][BISHOP]; ++i)
 	{
 		from = pieceSq[turn][BISHOP][i];
-		revealMoves<TURN, LEGAL>(from, magicBishopAttacks(from, occupiedBB()) & destBB, moves);
+		revealMoves<TURN, LEGAL>(from, magicBishopAttacks(from, occupiedBB()) & destBB, moves, pinned);
 	}
 	for (int i = 0; i < pieceCount[TURN][QUEEN]; ++i)
 	{
 		from = pieceSq[turn][QUEEN][i];
-		revealMoves<TURN, LEGAL>(from, magicBishopAttacks(from, occupiedBB()) & destBB, moves);
+		revealMoves<TURN, LEGAL>(from, magicBishopAttacks(from, occupiedBB()) & destBB, moves, pinned);
 	}
 }
 
@@ -450,27 +533,31 @@ void Position::generateMoves(MoveList& moves) const
 		assert(isInCheck());
 
 		const Square kingSq = pieceSq[TURN][KING][0];
-		const Bitboard checkers = allAttackers(kingSq, opposite(TURN));
+		const Bitboard checkers = info.checkers;
 		// There must be at least one checker and in standard chess there are no tripple ot higher order checks
 		assert(checkers && countSet(checkers) <= 2);
 		// Generate king moves to unattacked squares
 		const Bitboard rescueBB = ~colorBB[TURN] & bbKingAttack[kingSq];
-		revealMoves<TURN, LEGAL>(kingSq, rescueBB, moves);
+		revealKingMoves<TURN, LEGAL>(rescueBB, moves);
 		// If check is not double, we can obstruct checking path or capture the checker
 		if (zeroOrSingular(checkers)) // we know it's not zero
 		{
 			const Square checker = getLSB(checkers);
-			const Bitboard destBB = bbBetween[checker][kingSq] | bbSquare[checker];
+			const Bitboard destBB = betweenBB(checker, kingSq) | bbSquare[checker];
+			// Pinned piece can never evade (its pin line and checking line intersect only at the king)
+			const Bitboard pinned = LEGAL ? pinnedPieces(TURN) : Bitboard();
 			// Generate pawn and usual piece (without king) moves to appropriate
 			// destinations, omit castlings (they can't be legal during checks)
-			generatePawnMoves<TURN, MG_TYPE, LEGAL>(moves, destBB);
-			generateFigureMoves<TURN, LEGAL>(moves, destBB);
+			generatePawnMoves<TURN, MG_TYPE, LEGAL>(moves, pinned, destBB);
+			generateFigureMoves<TURN, LEGAL>(moves, pinned, destBB);
 		}
 	}
 	else
 	{
+		// We aren't in check, so only pinned pieces may have illegal moves (besides king and en passant)
+		const Bitboard pinned = LEGAL ? pinnedPieces(TURN) : Bitboard();
 		// Pawn moves
-		generatePawnMoves<TURN, MG_TYPE, LEGAL>(moves);
+		generatePawnMoves<TURN, MG_TYPE, LEGAL>(moves, pinned);
 		// Castlings. Their legality (king's path should not be under attack) is checked right here
 		if constexpr (MG_TYPE != MG_CAPTURES)
 		{
@@ -493,10 +580,9 @@ void Position::generateMoves(MoveList& moves) const
 			destBB = emptyBB();
 		else // if constexpr (MG_TYPE == MG_ALL), omitted because MG_EVASIONS is handled before
 			destBB = ~colorBB[TURN];
-		generateFigureMoves<TURN, LEGAL>(moves, destBB);
+		generateFigureMoves<TURN, LEGAL>(moves, pinned, destBB);
 		// King moves
-		const Square kingSq = pieceSq[turn][KING][0];
-		revealMoves<TURN, LEGAL>(kingSq, bbKingAttack[kingSq] & destBB, moves);
+		revealKingMoves<TURN, LEGAL>(bbKingAttack[pieceSq[TURN][KING][0]] & destBB, moves);
 	}
 	// For debugging purposes this is sometimes needed to make move
 	// ordering independent of current order of pieces in piece lists
@@ -900,22 +986,25 @@ void Position::loadFEN(std::istream& istr, bool omitCounters)
 	istr >> epFile;
 	if (epFile != '-')
 	{
-		int epRank;
-		istr >> epRank;
+		char epRankAN;
+		istr >> epRankAN;
+		const int8_t epRank = rankFromAN(epRankAN);
 		if (!validRank(epRank) || !validFile(fileFromAN(epFile))
-			|| (epRank != 2 && epRank != 5))
+			|| epRank != (turn == WHITE ? 5 : 2))
 			throw std::runtime_error("Invalid en-passant square "
-				+ std::string({ epFile, rankToAN(epRank) }));
-		info.epSquare = Square(fileFromAN(epFile), epRank);
+				+ std::string({ epFile, epRankAN }));
+		info.epSquare = Square(epRank, fileFromAN(epFile));
 		info.keyZobrist ^= ZobristEP[fileFromAN(epFile)];
 	}
 	if (!omitCounters)
 	{
 		// Halfmove counter (for 50 move draw rule) information
-		istr >> info.rule50;
-		if (info.rule50 < 0 || 50 < info.rule50)
-			throw std::runtime_error("Rule-50 halfmove counter"
-				+ std::to_string(info.rule50) + " is invalid ");
+		int rule50;
+		istr >> rule50;
+		if (rule50 < 0 || 100 < rule50)
+			throw std::runtime_error("Rule-50 halfmove counter "
+				+ std::to_string(rule50) + " is invalid");
+		info.rule50 = uint8_t(rule50);
 		// Counter of full moves (starting at 1) information
 		int fullMoves;
 		istr >> fullMoves;
@@ -924,6 +1013,7 @@ void Position::loadFEN(std::istream& istr, bool omitCounters)
 				+ std::to_string(fullMoves));
 		gamePly = (fullMoves - 1) * 2 + (side == 'b' ? 1 : 0);
 	}
+	updateCheckInfo();
 }
 
 //============================================================
@@ -960,9 +1050,13 @@ void Position::writeFEN(std::ostream& ostr, bool omitCounters) const
 			char cur_ch = pieceTypeToFEN(getPieceType(curPiece));
 			if (getPieceSide(curPiece) == BLACK)
 				cur_ch = tolower(cur_ch);
+			ostr << cur_ch;
 		}
 		if (consecutiveEmpty)
+		{
 			ostr << consecutiveEmpty;
+			consecutiveEmpty = 0;
+		}
 		ostr << (rank == 0 ? ' ' : '/');
 	}
 	// Side to move information
@@ -986,43 +1080,47 @@ void Position::writeFEN(std::ostream& ostr, bool omitCounters) const
 	if (info.epSquare == Sq::NONE)
 		ostr << "- ";
 	else
-		ostr << info.epSquare.file() + 'a' << info.epSquare.rank() << ' ';
+		ostr << fileToAN(info.epSquare.file()) << rankToAN(info.epSquare.rank()) << ' ';
 	if (!omitCounters)
 	{
 		// Halfmove counter (for 50 move draw rule) information
-		ostr << info.rule50 << ' ';
+		ostr << int(info.rule50) << ' ';
 		// Counter of full moves (starting at 1) information
-		ostr << gamePly / 2;
+		ostr << gamePly / 2 + 1;
 	}
 }
 
 //============================================================
 // Explicit template instantiations
 //============================================================
-template void Position::revealPawnMoves<WHITE, true>(Bitboard, Square, MoveList&) const;
-template void Position::revealPawnMoves<WHITE, false>(Bitboard, Square, MoveList&) const;
-template void Position::revealPawnMoves<BLACK, true>(Bitboard, Square, MoveList&) const;
-template void Position::revealPawnMoves<BLACK, false>(Bitboard, Square, MoveList&) const;
-template void Position::revealMoves<WHITE, true>(Square, Bitboard, MoveList&) const;
-template void Position::revealMoves<WHITE, false>(Square, Bitboard, MoveList&) const;
-template void Position::revealMoves<BLACK, true>(Square, Bitboard, MoveList&) const;
-template void Position::revealMoves<BLACK, false>(Square, Bitboard, MoveList&) const;
-template void Position::generatePawnMoves<WHITE, MG_NON_CAPTURES, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<WHITE, MG_NON_CAPTURES, false>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<WHITE, MG_CAPTURES, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<WHITE, MG_CAPTURES, false>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<WHITE, MG_ALL, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<WHITE, MG_ALL, false>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_NON_CAPTURES, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_NON_CAPTURES, false>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_CAPTURES, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_CAPTURES, false>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_ALL, true>(MoveList&, Bitboard) const;
-template void Position::generatePawnMoves<BLACK, MG_ALL, false>(MoveList&, Bitboard) const;
-template void Position::generateFigureMoves<WHITE, true>(MoveList&, Bitboard) const;
-template void Position::generateFigureMoves<WHITE, false>(MoveList&, Bitboard) const;
-template void Position::generateFigureMoves<BLACK, true>(MoveList&, Bitboard) const;
-template void Position::generateFigureMoves<BLACK, false>(MoveList&, Bitboard) const;
+template void Position::revealPawnMoves<WHITE, true>(Bitboard, Square, MoveList&, Bitboard) const;
+template void Position::revealPawnMoves<WHITE, false>(Bitboard, Square, MoveList&, Bitboard) const;
+template void Position::revealPawnMoves<BLACK, true>(Bitboard, Square, MoveList&, Bitboard) const;
+template void Position::revealPawnMoves<BLACK, false>(Bitboard, Square, MoveList&, Bitboard) const;
+template void Position::revealMoves<WHITE, true>(Square, Bitboard, MoveList&, Bitboard) const;
+template void Position::revealMoves<WHITE, false>(Square, Bitboard, MoveList&, Bitboard) const;
+template void Position::revealMoves<BLACK, true>(Square, Bitboard, MoveList&, Bitboard) const;
+template void Position::revealMoves<BLACK, false>(Square, Bitboard, MoveList&, Bitboard) const;
+template void Position::revealKingMoves<WHITE, true>(Bitboard, MoveList&) const;
+template void Position::revealKingMoves<WHITE, false>(Bitboard, MoveList&) const;
+template void Position::revealKingMoves<BLACK, true>(Bitboard, MoveList&) const;
+template void Position::revealKingMoves<BLACK, false>(Bitboard, MoveList&) const;
+template void Position::generatePawnMoves<WHITE, MG_NON_CAPTURES, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<WHITE, MG_NON_CAPTURES, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<WHITE, MG_CAPTURES, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<WHITE, MG_CAPTURES, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<WHITE, MG_ALL, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<WHITE, MG_ALL, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_NON_CAPTURES, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_NON_CAPTURES, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_CAPTURES, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_CAPTURES, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_ALL, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generatePawnMoves<BLACK, MG_ALL, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generateFigureMoves<WHITE, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generateFigureMoves<WHITE, false>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generateFigureMoves<BLACK, true>(MoveList&, Bitboard, Bitboard) const;
+template void Position::generateFigureMoves<BLACK, false>(MoveList&, Bitboard, Bitboard) const;
 template void Position::generateMoves<WHITE, MG_EVASIONS, true>(MoveList&) const;
 template void Position::generateMoves<WHITE, MG_EVASIONS, false>(MoveList&) const;
 template void Position::generateMoves<WHITE, MG_NON_CAPTURES, true>(MoveList&) const;
@@ -1039,5 +1137,7 @@ template void Position::generateMoves<BLACK, MG_CAPTURES, true>(MoveList&) const
 template void Position::generateMoves<BLACK, MG_CAPTURES, false>(MoveList&) const;
 template void Position::generateMoves<BLACK, MG_ALL, true>(MoveList&) const;
 template void Position::generateMoves<BLACK, MG_ALL, false>(MoveList&) const;
-template int Position::perft<false>(Depth);
-template int Position::perft<true>(Depth);
\ No newline at end of file
+template uint64_t Position::perft<false>(Depth);
+template uint64_t Position::perft<true>(Depth);
+template std::vector<std::pair<Move, uint64_t>> Position::perftDivide<false>(Depth);
+template std::vector<std::pair<Move, uint64_t>> Position::perftDivide<true>(Depth);
\ No newline at end of file
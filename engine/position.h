@@ -7,6 +7,7 @@
 #ifndef _POSITION_H
 #define _POSITION_H
 #include <utility>
+#include <vector>
 #include <cassert>
 #include <sstream>
 #include "bitboard.h"
@@ -39,6 +40,11 @@ namespace BlendXChess
 		Square epSquare; // Square to which endTime passant is possible (if the last move was double pushed pawn)
 		CastlingRight castlingRight; // Mask representing valid castlings
 		Key keyZobrist; // Zobrist key of the position
+		// Check information. It is computed once when position arises, so that legality
+		// and check tests don't need attack detection for the king. Whether a move gives
+		// check is rarely asked, so that is computed on demand instead
+		Bitboard checkers; // Pieces giving check to the side to move
+		Bitboard blockers; // Pieces (of any side) which are alone between king of side to move and enemy slider
 	};
 
 	constexpr inline bool operator!=(PositionInfo p1, PositionInfo p2)
@@ -58,6 +64,7 @@ namespace BlendXChess
 	{
 		friend class Game;
 		friend class Searcher;
+		friend class ParallelPerft;
 		friend class MoveManager<true>;
 		friend class MoveManager<false>;
 	public:
@@ -81,18 +88,29 @@ namespace BlendXChess
 		void clear(void);
 		// Reset position
 		void reset(void);
-		// Performs a perft for current position, returns count of visited nodes
+		// Performs a perft for current position, returns count of leaf nodes
 		// If MG_LEGAL == true, includes all moves (with promotions to rooks and bishops)
 		template<bool MG_LEGAL = false>
-		int perft(Depth);
+		uint64_t perft(Depth);
+		// Same as perft, but returns leaf count of each root move separately
+		template<bool MG_LEGAL = false>
+		std::vector<std::pair<Move, uint64_t>> perftDivide(Depth);
 		// Whether a square is attacked by given side
 		inline bool isAttacked(Square, Side) const;
+		// Whether a square is attacked by given side if occupancy were as given
+		inline bool isAttacked(Square, Side, Bitboard) const;
 		// Least valuable attacker on given square by given side (king is considered most valuable here)
 		inline Square leastAttacker(Square, Side) const;
 		// All attackers on given square by given side
 		inline Bitboard allAttackers(Square, Side) const;
+		// All attackers on given square by given side if occupancy were as given
+		inline Bitboard allAttackers(Square, Side, Bitboard) const;
+		// Pieces of given side which are pinned to their king
+		inline Bitboard pinnedPieces(Side) const;
 		// Whether current side is in check
 		inline bool isInCheck(void) const;
+		// Whether given move gives check. It should be pseudo-legal in current position
+		inline bool givesCheck(Move) const;
 		// Convert a move from AN notation to Move. It should be valid in current position
 		Move moveFromAN(const std::string&);
 		// Convert a move from SAN notation to Move. It should be valid in current position
@@ -130,28 +148,41 @@ namespace BlendXChess
 		// Internal doing and undoing moves
 		void doMove(Move, PositionInfo&);
 		void undoMove(Move, const PositionInfo&);
+		// Computes check information of info for current position
+		void updateCheckInfo(void);
+		// Pieces (of any side) which are alone between king of given side and enemy slider
+		inline Bitboard sliderBlockers(Side) const;
 		// Whether the move is a capture
 		inline bool isCaptureMove(Move) const;
 		// Internal test for pseudo-legality (still assumes some conditions which TT-move must satisfy)
 		bool isPseudoLegal(Move) const;
 		// Internal test for legality (assumes pseudo-legality of argument)
 		inline bool isLegal(Move) const;
+		// Legality test for en passant move (assumes pseudo-legality of argument). Such move removes
+		// two pieces from one rank, so it is the only one which can reveal a check along that rank
+		inline bool isLegalEnPassant(Move) const;
 		// Helper for move generating functions
-		// It adds pseudo-legal move to vector if LEGAL == false or, otherwise, if move is legal
+		// It adds pseudo-legal non-king move to vector if LEGAL == false or, otherwise, if
+		// its piece is not pinned (given bitboard of pinned pieces) or moves along the pin line
 		template<Side TURN, bool LEGAL>
-		inline void addMoveIfSuitable(Move, MoveList&) const;
+		inline void addMoveIfSuitable(Move, MoveList&, Bitboard) const;
 		// Reveal PAWN moves in given direction from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
 		template<Side TURN, bool LEGAL>
-		void revealPawnMoves(Bitboard, Square, MoveList&) const;
-		// Reveal NON-PAWN moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
+		void revealPawnMoves(Bitboard, Square, MoveList&, Bitboard) const;
+		// Reveal NON-PAWN and NON-KING moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
+		template<Side TURN, bool LEGAL>
+		void revealMoves(Square, Bitboard, MoveList&, Bitboard) const;
+		// Reveal KING moves from attack bitboard (legal if LEGAL == true and pseudolegal otherwise)
 		template<Side TURN, bool LEGAL>
-		void revealMoves(Square, Bitboard, MoveList&) const;
+		void revealKingMoves(Bitboard, MoveList&) const;
 		// Generate pawn moves. If MG_TYPE == MG_EVASIONS, only to distBB squares
+		// Bitboard of pinned pieces is used only if LEGAL == true
 		template<Side TURN, MoveGen MG_TYPE, bool LEGAL>
-		void generatePawnMoves(MoveList&, Bitboard = Bitboard()) const;
+		void generatePawnMoves(MoveList&, Bitboard, Bitboard = Bitboard()) const;
 		// Generate non-pawn and non-king moves. Only to destBB squares irrespectively of MG_TYPE
+		// Bitboard of pinned pieces is used only if LEGAL == true
 		template<Side TURN, bool LEGAL>
-		void generateFigureMoves(MoveList&, Bitboard) const;
+		void generateFigureMoves(MoveList&, Bitboard, Bitboard) const;
 		// Generate moves (legal if LEGAL == true and pseudolegal otherwise)
 		template<Side TURN, MoveGen MG_TYPE, bool LEGAL>
 		void generateMoves(MoveList&) const;
@@ -227,7 +258,7 @@ namespace BlendXChess
 
 	inline bool Position::isInCheck(void) const
 	{
-		return isAttacked(pieceSq[turn][KING][0], opposite(turn));
+		return info.checkers != 0;
 	}
 
 	inline std::string Position::getFEN(bool omitCounters) const
@@ -287,14 +318,23 @@ namespace BlendXChess
 	// Whether a square is attacked by given side
 	//============================================================
 	inline bool Position::isAttacked(Square sq, Side by) const
+	{
+		return isAttacked(sq, by, occupiedBB());
+	}
+
+	//============================================================
+	// Whether a square is attacked by given side if occupancy were as
+	// given (eg with the king removed, so that it can't hide behind itself)
+	//============================================================
+	inline bool Position::isAttacked(Square sq, Side by, Bitboard occupancy) const
 	{
 		assert(by == WHITE || by == BLACK);
 		assert(sq.isValid());
 		return (bbPawnAttack[opposite(by)][sq] & pieceBB(by, PAWN)) ||
 			(bbKnightAttack[sq] & pieceBB(by, KNIGHT)) ||
 			(bbKingAttack[sq] & pieceBB(by, KING)) ||
-			(magicRookAttacks(sq, occupiedBB()) & (pieceBB(by, ROOK) | pieceBB(by, QUEEN))) ||
-			(magicBishopAttacks(sq, occupiedBB()) & (pieceBB(by, BISHOP) | pieceBB(by, QUEEN)));
+			(magicRookAttacks(sq, occupancy) & (pieceBB(by, ROOK) | pieceBB(by, QUEEN))) ||
+			(magicBishopAttacks(sq, occupancy) & (pieceBB(by, BISHOP) | pieceBB(by, QUEEN)));
 	}
 
 	//============================================================
@@ -327,13 +367,114 @@ namespace BlendXChess
 	//============================================================
 	inline Bitboard Position::allAttackers(Square sq, Side by) const
 	{
-		Bitboard mBA, mRA;
+		return allAttackers(sq, by, occupiedBB());
+	}
+
+	//============================================================
+	// All attackers on given square by given side if occupancy were as given
+	//============================================================
+	inline Bitboard Position::allAttackers(Square sq, Side by, Bitboard occupancy) const
+	{
+		const Bitboard mBA = magicBishopAttacks(sq, occupancy), mRA = magicRookAttacks(sq, occupancy);
 		return (bbPawnAttack[opposite(by)][sq] & pieceBB(by, PAWN))
 			| (bbKnightAttack[sq] & pieceBB(by, KNIGHT))
 			| (bbKingAttack[sq] & pieceBB(by, KING))
-			| ((mBA = magicBishopAttacks(sq, occupiedBB())) & pieceBB(by, BISHOP))
-			| ((mRA = magicRookAttacks(sq, occupiedBB())) & pieceBB(by, ROOK))
-			| ((mBA | mRA) & pieceBB(by, QUEEN));
+			| (mBA & (pieceBB(by, BISHOP) | pieceBB(by, QUEEN)))
+			| (mRA & (pieceBB(by, ROOK) | pieceBB(by, QUEEN)));
+	}
+
+	//============================================================
+	// Pieces (of any side) which are alone between king of given side and enemy
+	// slider that would attack it otherwise. Ones of the king's side are pinned,
+	// while moving others away from the line gives discovered check
+	//============================================================
+	inline Bitboard Position::sliderBlockers(Side c) const
+	{
+		const Square kingSq = pieceSq[c][KING][0];
+		const Side opp = opposite(c);
+		// Enemy sliders which would attack the king on an empty board
+		Bitboard snipers = (bbAttackEB[ROOK][kingSq] & (pieceBB(opp, ROOK) | pieceBB(opp, QUEEN)))
+			| (bbAttackEB[BISHOP][kingSq] & (pieceBB(opp, BISHOP) | pieceBB(opp, QUEEN)));
+		Bitboard blockers = 0;
+		while (snipers)
+		{
+			const Bitboard between = betweenBB(popLSB(snipers), kingSq) & occupiedBB();
+			if (zeroOrSingular(between))
+				blockers |= between;
+		}
+		return blockers;
+	}
+
+	//============================================================
+	// Pieces of given side which are pinned to their king
+	//============================================================
+	inline Bitboard Position::pinnedPieces(Side c) const
+	{
+		return (c == turn ? info.blockers : sliderBlockers(c)) & colorBB[c];
+	}
+
+	//============================================================
+	// Whether given move gives check. It should be pseudo-legal in current position
+	//============================================================
+	inline bool Position::givesCheck(Move move) const
+	{
+		const Square from = move.from(), to = move.to();
+		const Square oppKingSq = pieceSq[opposite(turn)][KING][0];
+		const Bitboard occupancy = occupiedBB();
+		// Direct check (castling and promotion are tested below, since king and pawn don't check from there)
+		switch (getPieceType(board[from]))
+		{
+		case PAWN:		if (bbPawnAttack[opposite(turn)][oppKingSq] & bbSquare[to]) return true; break;
+		case KNIGHT:	if (bbKnightAttack[oppKingSq] & bbSquare[to]) return true; break;
+		case BISHOP:	if (magicBishopAttacks(oppKingSq, occupancy) & bbSquare[to]) return true; break;
+		case ROOK:		if (magicRookAttacks(oppKingSq, occupancy) & bbSquare[to]) return true; break;
+		case QUEEN:		if ((magicBishopAttacks(oppKingSq, occupancy) | magicRookAttacks(oppKingSq, occupancy))
+			& bbSquare[to]) return true; break;
+		}
+		// Discovered check (moving piece leaves line between our slider and opponent's king). Our
+		// sliders can't attack the king before the move, so any attack without the piece is discovered
+		if (const Bitboard line = lineBB(from, oppKingSq); line && !(line & bbSquare[to]))
+		{
+			const Bitboard discOccupancy = occupancy ^ bbSquare[from];
+			if ((magicRookAttacks(oppKingSq, discOccupancy) & (pieceBB(turn, ROOK) | pieceBB(turn, QUEEN)))
+				| (magicBishopAttacks(oppKingSq, discOccupancy) & (pieceBB(turn, BISHOP) | pieceBB(turn, QUEEN))))
+				return true;
+		}
+		switch (move.type())
+		{
+		case MT_PROMOTION:
+		{
+			const Bitboard promOccupancy = occupancy ^ bbSquare[from];
+			switch (move.promotion())
+			{
+			case KNIGHT:	return bbKnightAttack[to] & bbSquare[oppKingSq];
+			case BISHOP:	return magicBishopAttacks(to, promOccupancy) & bbSquare[oppKingSq];
+			case ROOK:		return magicRookAttacks(to, promOccupancy) & bbSquare[oppKingSq];
+			default:		return (magicBishopAttacks(to, promOccupancy)
+				| magicRookAttacks(to, promOccupancy)) & bbSquare[oppKingSq];
+			}
+		}
+		case MT_EN_PASSANT:
+		{
+			// Captured pawn may have been the only piece between our slider and opponent's king
+			const Square captured = Square(from.rank(), to.file());
+			const Bitboard epOccupancy = occupancy ^ bbSquare[from] ^ bbSquare[to] ^ bbSquare[captured];
+			return (magicRookAttacks(oppKingSq, epOccupancy) & (pieceBB(turn, ROOK) | pieceBB(turn, QUEEN)))
+				| (magicBishopAttacks(oppKingSq, epOccupancy) & (pieceBB(turn, BISHOP) | pieceBB(turn, QUEEN)));
+		}
+		case MT_CASTLING:
+		{
+			// Only castled rook can give check
+			const bool kingSide = to > from;
+			const Square rookFrom = Square(from.rank(), kingSide ? fileFromAN('h') : fileFromAN('a'));
+			const Square rookTo = Square(from.rank(), kingSide ? fileFromAN('f') : fileFromAN('d'));
+			const Bitboard castlingOccupancy = occupancy ^ bbSquare[from] ^ bbSquare[to]
+				^ bbSquare[rookFrom] ^ bbSquare[rookTo];
+			return magicRookAttacks(rookTo, castlingOccupancy) & bbSquare[oppKingSq];
+		}
+		default:
+			return false;
+		}
 	}
 
 	inline void Position::removeCastlingRight(CastlingRight cr)
@@ -345,27 +486,44 @@ namespace BlendXChess
 
 	inline bool Position::isLegal(Move move) const
 	{
-		// MAYBE TEMPORARY (relatively slow and easy approach is used)
-		PositionInfo prevState;
-		// Here const_cast-approach is acceptable since the principal structure of position
-		// is not changed, even though e.g. order of elements in piece lists may be changed
-		auto* const thisObj = const_cast<Position*>(this);
-		thisObj->doMove(move, prevState);
-		const bool legal = !isAttacked(pieceSq[opposite(turn)][KING][0], turn);
-		thisObj->undoMove(move, prevState);
-		return legal;
+		const Square from = move.from(), to = move.to(), kingSq = pieceSq[turn][KING][0];
+		// Castling conditions (including attacks on king's path) are checked by isPseudoLegal
+		if (move.type() == MT_CASTLING)
+			return true;
+		if (move.type() == MT_EN_PASSANT)
+			return isLegalEnPassant(move);
+		// King can't go to attacked square (it shouldn't hide behind itself from sliders)
+		if (from == kingSq)
+			return !isAttacked(to, opposite(turn), occupiedBB() ^ bbSquare[kingSq]);
+		// Other pieces should resolve the check if it is present...
+		if (info.checkers)
+			if (!zeroOrSingular(info.checkers)
+				|| !((betweenBB(getLSB(info.checkers), kingSq) | info.checkers) & bbSquare[to]))
+				return false;
+		// ...and leave the king covered if they are pinned
+		return !(pinnedPieces(turn) & bbSquare[from]) || lineBB(kingSq, from) & bbSquare[to];
+	}
+
+	inline bool Position::isLegalEnPassant(Move move) const
+	{
+		assert(move.type() == MT_EN_PASSANT);
+		const Square from = move.from(), to = move.to(), kingSq = pieceSq[turn][KING][0];
+		const Square captured = Square(from.rank(), to.file());
+		const Bitboard occupancy = occupiedBB() ^ bbSquare[from] ^ bbSquare[to] ^ bbSquare[captured];
+		// Captured pawn doesn't attack anything after the move
+		return !(allAttackers(kingSq, opposite(turn), occupancy) & ~bbSquare[captured]);
 	}
 
 	template<MoveGen MG_TYPE>
 	inline void Position::generateLegalMoves(MoveList& moves) const
 	{
 		if (turn == WHITE)
-			if (isAttacked(pieceSq[WHITE][KING][0], BLACK))
+			if (info.checkers)
 				generateMoves<WHITE, MG_EVASIONS, true>(moves);
 			else
 				generateMoves<WHITE, MG_TYPE, true>(moves);
 		else
-			if (isAttacked(pieceSq[BLACK][KING][0], WHITE))
+			if (info.checkers)
 				generateMoves<BLACK, MG_EVASIONS, true>(moves);
 			else
 				generateMoves<BLACK, MG_TYPE, true>(moves);
@@ -375,12 +533,12 @@ namespace BlendXChess
 	inline void Position::generatePseudolegalMoves(MoveList& moves) const
 	{
 		if (turn == WHITE)
-			if (isAttacked(pieceSq[WHITE][KING][0], BLACK))
+			if (info.checkers)
 				generateMoves<WHITE, MG_EVASIONS, false>(moves);
 			else
 				generateMoves<WHITE, MG_TYPE, false>(moves);
 		else
-			if (isAttacked(pieceSq[BLACK][KING][0], WHITE))
+			if (info.checkers)
 				generateMoves<BLACK, MG_EVASIONS, false>(moves);
 			else
 				generateMoves<BLACK, MG_TYPE, false>(moves);
@@ -405,25 +563,18 @@ namespace BlendXChess
 	}
 
 	template<Side TURN, bool LEGAL>
-	inline void Position::addMoveIfSuitable(Move move, MoveList& moves) const
+	inline void Position::addMoveIfSuitable(Move move, MoveList& moves, Bitboard pinned) const
 	{
 		static_assert(TURN == WHITE || TURN == BLACK,
 			"TURN template parameter should be either WHITE or BLACK in this function");
-		// If we are looking for legal moves, do a legality check
+		// If we are looking for legal moves, do a legality check. Checks are already taken into account
+		// by generator's destination squares, so only a pin can make the move illegal here
+		// Score is set in move scoring function of Engine class, thus omitted
 		if constexpr (LEGAL)
 		{
-			PositionInfo prevState;
-			// Here const_cast-approach is acceptable since the principal structure of position
-			// is not changed, even though e.g. order of elements in piece lists may be changed
-			auto* const thisObj = const_cast<Position*>(this);
-			// A pseudolegal move is legal iff the king is not under attack when it is performed
-			thisObj->doMove(move, prevState);
-			// After doMove, turn has changed until undoMove, so it is critical that in the next two lines we use TURN
-			// Score is set in move scoring function of Engine class, thus omitted
-			if (!isAttacked(pieceSq[TURN][KING][0], opposite(TURN)))
+			if (!(pinned & bbSquare[move.from()])
+				|| lineBB(pieceSq[TURN][KING][0], move.from()) & bbSquare[move.to()])
 				moves.add(move);
-			// Restore to a previous state
-			thisObj->undoMove(move, prevState);
 		}
 		// If we are looking for pseudolegal moves, don't check anything, as we already know that move is pseudolegal
 		else
@@ -4,6 +4,7 @@
 //============================================================
 
 #include <chrono>
+#include <cstring>
 #include <algorithm>
 #include "search.h"
 #include "move_manager.h"
@@ -14,9 +15,11 @@ using namespace BlendXChess;
 // Constructor
 //============================================================
 MultiSearcher::MultiSearcher(const SearchOptions& opt)
-	: inSearch(false)
+	: options(), inSearch(false)
 {
 	shared.processer = [](const SearchEvent&) {}; // Default no-op processer
+	shared.threads = &threads;
+	shared.multiSearcher = this;
 	setOptions(opt);
 }
 
@@ -25,72 +28,298 @@ MultiSearcher::MultiSearcher(const SearchOptions& opt)
 //============================================================
 MultiSearcher::~MultiSearcher(void)
 {
-	// We need this in case there's still some search OR if the last search
-	// was finished internally (so main thread was not joined)
-	if (!threads.empty() && threads[0].handle.joinable())
+	// Stop the search in progress (if any) without notifying the processer
+	shared.externalStop = true;
+	shared.stopSearch = true;
 	{
-		shared.stopSearch = true;
-		threads[0].handle.join();
+		std::lock_guard<std::mutex> lock(shared.finishMutex);
 	}
+	shared.finishCondition.notify_all();
+	// Main search thread uses helpers until it parks, so it's waited for before any
+	// of them is terminated. Pool is shrunk from the back, so it's terminated the last
+	if (!threads.empty())
+		waitThread(threads[0]);
+	resizeThreadPool(0);
 }
 
 //============================================================
-// Constructor
+// Sets thread count and starts or terminates pool threads accordingly
+// During search the change is only requested, and main search thread
+// adds or retires helpers on its next limits check
 //============================================================
-Searcher::Searcher(const Position& pos, SearchOptions* options, SharedInfo* shared,
-	TranspositionTable* tt, ThreadInfo* threadLocal)
-	: pos(pos), options(options), shared(shared),
-	transpositionTable(tt), threadLocal(threadLocal)
+void MultiSearcher::setThreadCount(unsigned int threadCount)
 {
-	memset(prevMoves, 0, sizeof(prevMoves));
-	memset(history, 0, sizeof(history));
-	memset(countermoves, 0, sizeof(countermoves));
+	// Pool is resized even if the count was clamped (with a warning thrown)
+	auto applyThreadCount = [this] {
+		if (inSearch)
+			shared.requestedThreads = options.threadCount;
+		else
+			resizeThreadPool(options.threadCount);
+	};
+	try
+	{
+		clampSetter(options.threadCount, threadCount,
+			THREAD_COUNT_MIN, "Warning: Thread count must be positive and is set to 1",
+			getMaxThreadCount(), "Warning: Thread count is too big and is set to "
+			+ std::to_string(getMaxThreadCount()));
+	}
+	catch (const std::runtime_error&)
+	{
+		applyThreadCount();
+		throw;
+	}
+	applyThreadCount();
 }
 
 //============================================================
-// Initializer
+// Starts or terminates pool threads so that there are given count of them
+//============================================================
+void MultiSearcher::resizeThreadPool(unsigned int threadCount)
+{
+	while (threads.size() > threadCount)
+	{
+		ThreadInfo& threadInfo = threads.back();
+		{
+			std::lock_guard<std::mutex> lock(threadInfo.mutex);
+			threadInfo.terminate = true;
+		}
+		threadInfo.wakeCondition.notify_one();
+		threadInfo.handle.join();
+		threads.pop_back();
+	}
+	const size_t oldThreadCount = threads.size();
+	while (threads.size() < threadCount)
+	{
+		ThreadInfo& threadInfo = threads.emplace_back();
+		threadInfo.ID = int(threads.size()) - 1;
+		threadInfo.searching = true; // Until the thread sets itself up
+		threadInfo.handle = std::thread(&MultiSearcher::idleLoop, this, std::ref(threadInfo));
+	}
+	// New threads allocate their data in parallel, wait for them
+	for (size_t threadID = oldThreadCount; threadID < threads.size(); ++threadID)
+		waitThread(threads[threadID]);
+}
+
+//============================================================
+// Sets whether search threads are bound to NUMA nodes. Pool threads
+// are restarted then (so their data is allocated on the new nodes),
+// and the transposition table is interleaved across all nodes (or gets
+// default memory policy back). History tables of threads are kept
+//============================================================
+void MultiSearcher::setNumaPinning(bool numaPinning)
+{
+	if (inSearch)
+		throw std::runtime_error("Error: Can't change NUMA pinning while in search");
+	if (numaPinning == options.numaPinning)
+		return;
+	options.numaPinning = numaPinning;
+	if (numaPinning)
+		NumaTopology::get().interleave(&transpositionTable, sizeof(transpositionTable));
+	else
+		NumaTopology::get().resetMemoryPolicy(&transpositionTable, sizeof(transpositionTable));
+	// Parked threads don't touch their searchers, so these can be taken before termination
+	std::vector<std::unique_ptr<Searcher>> oldSearchers;
+	for (ThreadInfo& threadInfo : threads)
+		oldSearchers.push_back(std::move(threadInfo.searcher));
+	const unsigned int threadCount = unsigned(threads.size());
+	resizeThreadPool(0);
+	resizeThreadPool(threadCount);
+	for (unsigned int threadID = 0; threadID < threadCount; ++threadID)
+		threads[threadID].searcher->copyHistory(*oldSearchers[threadID]);
+}
+
+//============================================================
+// Loop of a pool thread: sets itself up, then sleeps until woken to
+// search or terminated. Main thread coordinates the whole search,
+// others just search
+//============================================================
+void MultiSearcher::idleLoop(ThreadInfo& threadInfo)
+{
+	// Bind to a node before allocating, so that searcher data is first touched there
+	if (options.numaPinning)
+		NumaTopology::get().bindThread(NumaTopology::get().nodeOfThread(threadInfo.ID));
+	threadInfo.searcher = std::make_unique<Searcher>();
+	{
+		std::lock_guard<std::mutex> lock(threadInfo.mutex);
+		threadInfo.searching = false;
+	}
+	threadInfo.wakeCondition.notify_all();
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(threadInfo.mutex);
+			threadInfo.wakeCondition.wait(lock,
+				[&threadInfo] { return threadInfo.searching || threadInfo.terminate; });
+			if (threadInfo.terminate)
+				return;
+		}
+		if (threadInfo.ID == 0)
+			search();
+		else if (options.smpMode == SMPMode::YBWC)
+			threadInfo.searcher->splitPointLoop();
+		else
+			threadInfo.searcher->idSearch(shared.limits.depth, threadInfo.startDepth);
+		{
+			std::lock_guard<std::mutex> lock(threadInfo.mutex);
+			threadInfo.searching = false;
+		}
+		threadInfo.wakeCondition.notify_all();
+	}
+}
+
+//============================================================
+// Wakes given pool thread to search
+//============================================================
+void MultiSearcher::wakeThread(ThreadInfo& threadInfo)
+{
+	{
+		std::lock_guard<std::mutex> lock(threadInfo.mutex);
+		threadInfo.searching = true;
+	}
+	threadInfo.wakeCondition.notify_all();
+}
+
+//============================================================
+// Waits until given pool thread finishes its search
+//============================================================
+void MultiSearcher::waitThread(ThreadInfo& threadInfo)
+{
+	std::unique_lock<std::mutex> lock(threadInfo.mutex);
+	threadInfo.wakeCondition.wait(lock, [&threadInfo] { return !threadInfo.searching; });
+}
+
+//============================================================
+// Default constructor
+//============================================================
+Searcher::Searcher(void)
+	: options(nullptr), shared(nullptr), transpositionTable(nullptr), threadLocal(nullptr), splitPoint(nullptr)
+{
+	clearHistory();
+}
+
+//============================================================
+// Initializer (should be called before each search and on reactivation
+// of a helper during search). History tables are kept, ageHistory is
+// called separately once per search
 //============================================================
 void Searcher::initialize(const Position& pos, SearchOptions* options, SharedInfo* shared,
 	TranspositionTable* tt, ThreadInfo* threadLocal)
 {
 	assert(options && tt && shared && threadLocal);
-	new(this)Searcher(pos, options, shared, tt, threadLocal);
+	this->pos = pos;
+	this->options = options;
+	this->shared = shared;
+	this->transpositionTable = tt;
+	this->threadLocal = threadLocal;
+	splitPoint = nullptr;
+	for (SearchStackEntry& entry : searchStack)
+	{
+		entry.move = MOVE_NONE;
+		entry.movedPiece = PIECE_NULL;
+		entry.staticEval = SCORE_NONE;
+		entry.contHistory = nullptr;
+		entry.pvLength = 0;
+		std::fill(std::begin(entry.killers), std::end(entry.killers), MOVE_NONE);
+	}
+}
+
+//============================================================
+// Clear history tables (typically when new game starts)
+//============================================================
+void Searcher::clearHistory(void)
+{
+	memset(history, 0, sizeof(history));
+	memset(countermoves, 0, sizeof(countermoves));
+	memset(continuationHistory, 0, sizeof(continuationHistory));
+	memset(captureHistory, 0, sizeof(captureHistory));
+}
+
+//============================================================
+// Copy history tables from given searcher (when searchers are reallocated)
+//============================================================
+void Searcher::copyHistory(const Searcher& other)
+{
+	memcpy(history, other.history, sizeof(history));
+	memcpy(countermoves, other.countermoves, sizeof(countermoves));
+	memcpy(continuationHistory, other.continuationHistory, sizeof(continuationHistory));
+	memcpy(captureHistory, other.captureHistory, sizeof(captureHistory));
 }
 
 //============================================================
-// Starts search with given depth
+// Scale history tables down before new search, so that knowledge
+// from previous moves of the game is kept, but doesn't dominate
 //============================================================
-void MultiSearcher::startSearch(const Position& pos)
+void Searcher::ageHistory(void)
+{
+	for (auto& fromHistory : history)
+		for (MoveScore& entry : fromHistory)
+			entry /= HISTORY_AGING_DIV;
+	for (auto& pieceHistory : continuationHistory)
+		for (PieceToHistory& pth : pieceHistory)
+			for (auto& toHistory : pth)
+				for (int16_t& entry : toHistory)
+					entry /= HISTORY_AGING_DIV;
+	for (auto& pieceHistory : captureHistory)
+		for (auto& toHistory : pieceHistory)
+			for (int16_t& entry : toHistory)
+				entry /= HISTORY_AGING_DIV;
+}
+
+//============================================================
+// Clear history tables of all search threads
+//============================================================
+void MultiSearcher::clearHistory(void)
+{
+	if (inSearch)
+		throw std::runtime_error("Error: Can't clear history while in search");
+	for (ThreadInfo& threadInfo : threads)
+		threadInfo.searcher->clearHistory();
+}
+
+//============================================================
+// Starts search with given limits (options are used if limits are empty)
+//============================================================
+void MultiSearcher::startSearch(const Position& pos, const SearchLimits& limits)
 {
 	// If we are already in search, the new one won't be launched
 	if (inSearch)
 		throw std::runtime_error("Another search is already launched");
-	// Set thread count and update thread vector accordingly
+	// If the last search was finished internally, the main thread
+	// may still be returning from it, so we wait for it here
+	waitThread(threads[0]);
+	// Set thread count and update thread pool accordingly
 	setThreadCount(options.threadCount);
 	// Indicate beginning of search
 	inSearch = true;
 	// Copy input position to internal storage (it's just safer
 	// not to assume it will remain valid during thread execution)
 	this->pos = pos;
-	// Safety check (TODO: maybe get rid of depth limiting (but then dynamic memory
-	// will be used in some places, with hopefully rarely (de-)allocating)?)
-	if (options.depth > SEARCH_DEPTH_MAX)
-		options.depth = SEARCH_DEPTH_MAX;
+	// Setup limits. Depth is taken from options only if no limit is given, otherwise
+	// search is unbounded by depth (but still TODO: maybe get rid of depth limiting
+	// (then dynamic memory will be used in some places, with hopefully rarely (de-)allocating)?)
+	shared.limits = limits;
+	if (shared.limits.depth == DEPTH_ZERO)
+		shared.limits.depth = limits.empty() ? options.depth : SEARCH_DEPTH_MAX;
+	shared.limits.depth = std::min(shared.limits.depth, SEARCH_DEPTH_MAX);
+	shared.timeManager.initialize(limits, pos.getTurn(), options.timeLimit, options.moveOverhead);
 	// Reset misc info
 	shared.stopSearch = false;
 	shared.externalStop = false;
 	shared.timeout = false;
-	// Start the main search thread. If the last search was finished
-	// internally, the main thread was not joined, so we need to join it here.
-	std::thread& mainThreadHandle = threads[0].handle;
-	if (mainThreadHandle.joinable()) // !
-		mainThreadHandle.join();
-	mainThreadHandle = std::thread(&MultiSearcher::search, this);
-	if (!mainThreadHandle.joinable())
-	{
-		inSearch = false;
-		throw std::runtime_error("Unable to create valid main search thread");
-	}
+	shared.pondering = limits.ponder;
+	shared.ponderTime = 0;
+	shared.stopCause = StopCause::DEPTH_REACHED;
+	// Start time is set here, so that ponderhit (which may come right after this) can use it
+	if constexpr (TIME_CHECK_ENABLED)
+		shared.startTime = std::chrono::high_resolution_clock::now();
+	for (auto& searchers : shared.rootMoveSearchers)
+		searchers.store(0, std::memory_order_relaxed);
+	for (auto& searchingKey : shared.searchingMoves)
+		searchingKey = 0;
+	shared.idleHelpers = 0;
+	shared.activeThreads = shared.requestedThreads = options.threadCount;
+	// Wake the main search thread
+	wakeThread(threads[0]);
 }
 
 //============================================================
@@ -105,14 +334,17 @@ SearchReturn MultiSearcher::endSearch(void)
 	// If it's not called from search(), we should wait for main search thread to finish
 	if (std::this_thread::get_id() != threads[0].handle.get_id())
 	{
-		// Set stop flag and wait for finishing search
+		// Set stop flag (external stop is set even if search has finished by itself, so that main
+		// search thread waiting for stop or ponderhit doesn't report results) and wait for finishing search
 		if (!shared.stopSearch)
-		{
 			shared.stopCause = StopCause::END_SEARCH_CALL;
-			shared.externalStop = true;
-			shared.stopSearch = true;
+		shared.externalStop = true;
+		shared.stopSearch = true;
+		{
+			std::lock_guard<std::mutex> lock(shared.finishMutex);
 		}
-		threads[0].handle.join();
+		shared.finishCondition.notify_all();
+		waitThread(threads[0]);
 	}
 	// Select best thread to retrieve info from
 	auto bestThreadIt = bestThread();
@@ -121,78 +353,226 @@ SearchReturn MultiSearcher::endSearch(void)
 	// Increment transposition table age (for future searches)
 	transpositionTable.incrementAge();
 	// Return the results
-	return lastSearchReturn = { bestThreadIt->results, shared.stats };
+	return lastSearchReturn = { bestThreadIt->results, shared.collectStats() };
 }
 
 //============================================================
-// Internal search logic (coordinates searching process, launches PVS-threads)
+// Switches pondering search to normal one (time starts being counted)
 //============================================================
-void MultiSearcher::search(void)
+void MultiSearcher::ponderHit(void)
 {
-	// Misc
-	if constexpr (TT_HITS_COUNT_ENABLED)
-		shared.stats.ttHits = 0;
-	if constexpr (SEARCH_NODES_COUNT_ENABLED)
-		shared.stats.visitedNodes = 0;
-	// Setup time management
+	if (!inSearch || !shared.pondering)
+		return;
+	// Pondering time is set before the flag is cleared, so that time limits never see it counted
 	if constexpr (TIME_CHECK_ENABLED)
+		shared.ponderTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::high_resolution_clock::now() - shared.startTime).count();
 	{
-		shared.startTime = std::chrono::high_resolution_clock::now();
-		shared.timeCheckCounter = 0;
+		std::lock_guard<std::mutex> lock(shared.finishMutex);
+		shared.pondering = false;
 	}
+	shared.finishCondition.notify_all();
+}
+
+//============================================================
+// Internal search logic (coordinates searching process, launches PVS-threads)
+//============================================================
+void MultiSearcher::search(void)
+{
+	// Misc (node and TT hit counts are per-thread and reset by searchers)
+	if constexpr (CUTOFFS_COUNT_ENABLED)
+		shared.stats.betaCutoffs = shared.stats.firstMoveCutoffs = 0;
 	// Set appropriate size for array containing count of threads search(-ing/-ed) at given depth from root
 	// shared.depthSearchedByCnt.resize(options.depth + 1);
-	// Setup helper threads
-	for (unsigned int threadID = 1; threadID < options.threadCount; ++threadID)
+	// Setup and wake helper threads (pool size is the thread count at the search start)
+	for (unsigned int threadID = 1; threadID < threads.size(); ++threadID)
 	{
 		ThreadInfo& threadInfo = threads[threadID];
-		threadInfo.ID = threadID;
-		threadInfo.searcher.initialize(pos, &options, &shared, &transpositionTable, &threadInfo);
-		threadInfo.handle = std::thread(&Searcher::idSearch, &threadInfo.searcher, options.depth);
+		threadInfo.searcher->ageHistory();
+		threadInfo.searcher->initialize(pos, &options, &shared, &transpositionTable, &threadInfo);
+		threadInfo.startDepth = 1;
+		threadInfo.retire = false;
+		wakeThread(threadInfo);
 	}
 	// Setup main (this) thread
-	threads[0].ID = 0;
-	threads[0].searcher.initialize(pos, &options, &shared, &transpositionTable, &threads[0]);
-	threads[0].searcher.idSearch(options.depth);
+	threads[0].searcher->ageHistory();
+	threads[0].searcher->initialize(pos, &options, &shared, &transpositionTable, &threads[0]);
+	threads[0].searcher->idSearch(shared.limits.depth);
 	// After finishing main thread, wait for others to finish
 	shared.stopSearch = true; // !
-	for (unsigned int threadID = 1; threadID < options.threadCount; ++threadID)
-		threads[threadID].handle.join();
+	// Helpers waiting for split points should notice that
+	if (options.smpMode == SMPMode::YBWC)
+		for (unsigned int threadID = 1; threadID < threads.size(); ++threadID)
+		{
+			ThreadInfo& threadInfo = threads[threadID];
+			{
+				std::lock_guard<std::mutex> lock(threadInfo.mutex);
+			}
+			threadInfo.wakeCondition.notify_all();
+		}
+	// Pool could grow during search, but only this thread changes it
+	for (unsigned int threadID = 1; threadID < threads.size(); ++threadID)
+		waitThread(threads[threadID]);
+	// Infinite search and pondering one are reported only after being stopped (or after ponderhit)
+	{
+		std::unique_lock<std::mutex> lock(shared.finishMutex);
+		shared.finishCondition.wait(lock, [this] {
+			return shared.externalStop || !(shared.limits.infinite || shared.pondering); });
+	}
 	// If the thread terminated not due to endSearch call, we should notify the user
 	if (!shared.externalStop)
 	{
-		if (!shared.timeout)
-			shared.stopCause = StopCause::DEPTH_REACHED;
 		shared.processer(SearchEvent(SearchEventType::FINISHED, endSearch()));
 	}
 }
 
+//============================================================
+// Adds or retires helpers if thread count was changed during search
+// Called by main search thread, which is the only one changing the pool
+// during search. New helpers start iterative deepening from given depth
+//============================================================
+void MultiSearcher::adjustActiveThreads(Depth startDepth)
+{
+	const unsigned int requested = shared.requestedThreads;
+	unsigned int active = shared.activeThreads;
+	// Retiring helpers finish current node (or split point) and park
+	for (; active > requested; --active)
+	{
+		ThreadInfo& threadInfo = threads[active - 1];
+		{
+			std::lock_guard<std::mutex> lock(threadInfo.mutex);
+			threadInfo.retire = true;
+		}
+		threadInfo.wakeCondition.notify_all();
+	}
+	if (active < requested && threads.size() < requested)
+	{
+		// Helpers booking threads for split points iterate the pool under split mutex
+		std::lock_guard<std::mutex> splitLock(shared.splitMutex);
+		resizeThreadPool(requested);
+	}
+	for (; active < requested; ++active)
+	{
+		ThreadInfo& threadInfo = threads[active];
+		// Helper retired earlier may still be finishing its search, then it's added on a later check
+		{
+			std::lock_guard<std::mutex> lock(threadInfo.mutex);
+			if (threadInfo.searching)
+				break;
+		}
+		threadInfo.searcher->initialize(pos, &options, &shared, &transpositionTable, &threadInfo);
+		threadInfo.startDepth = startDepth;
+		threadInfo.retire = false;
+		wakeThread(threadInfo);
+	}
+	shared.activeThreads = active;
+}
+
 //============================================================
 // Select (currently) best search thread
 //============================================================
 ThreadList::iterator MultiSearcher::bestThread(void)
 {
-	// !! TODO maybe there's a better way? !!
-	auto bestThreadIt = std::max_element(threads.begin(), threads.end(),
-		[](const ThreadInfo& ti1, const ThreadInfo& ti2) {
-		return ti1.results.resDepth < ti2.results.resDepth ||
-			(ti1.results.resDepth == ti2.results.resDepth
-				&& ti1.results.score < ti2.results.score);
-	});
-	assert(bestThreadIt != threads.end());
-	return bestThreadIt;
+	// Only main thread searches from the root in Young Brothers Wait mode
+	if (options.smpMode == SMPMode::YBWC)
+		return threads.begin();
+	std::vector<SearchResults> results;
+	results.reserve(threads.size());
+	for (const ThreadInfo& threadInfo : threads)
+		results.push_back(threadInfo.results);
+	return threads.begin() + voteBestResults(results);
+}
+
+//============================================================
+// Selects the best of given search results of threads by voting
+// Each thread which has completed some iteration votes for its best
+// move with weight growing with the completed depth and with the score
+// relative to the minimal one, so that a single deeper (or noisy) thread
+// can't override the consensus. Proven win is preferred though (the
+// shortest one), and among threads voting for the selected move the
+// deepest is taken. Returns index of the selected results
+//============================================================
+size_t MultiSearcher::voteBestResults(const std::vector<SearchResults>& results)
+{
+	assert(!results.empty());
+	Score minScore = SCORE_WIN;
+	for (const SearchResults& res : results)
+		if (res.resDepth > 0)
+			minScore = std::min(minScore, res.score);
+	std::vector<std::pair<Move, int64_t>> moveVotes;
+	auto votes = [&moveVotes](Move move) -> int64_t& {
+		for (auto& [votedMove, count] : moveVotes)
+			if (votedMove == move)
+				return count;
+		return moveVotes.emplace_back(move, 0).second;
+	};
+	for (const SearchResults& res : results)
+		if (res.resDepth > 0)
+			votes(res.bestMove) += int64_t(res.score - minScore + BEST_THREAD_VOTE_SCORE_OFFSET) * res.resDepth;
+	size_t bestIdx = 0;
+	for (size_t idx = 1; idx < results.size(); ++idx)
+	{
+		const SearchResults& res = results[idx];
+		const SearchResults& best = results[bestIdx];
+		if (res.resDepth == 0)
+			continue;
+		if (best.resDepth == 0)
+			bestIdx = idx;
+		else if (res.score >= SCORE_WIN_MIN || best.score >= SCORE_WIN_MIN)
+		{
+			if (res.score > best.score)
+				bestIdx = idx;
+		}
+		else if (votes(res.bestMove) > votes(best.bestMove)
+			|| (res.bestMove == best.bestMove && res.resDepth > best.resDepth))
+			bestIdx = idx;
+	}
+	return bestIdx;
+}
+
+//============================================================
+// Checks time and nodes limits, signals search stop and returns true if some of them is reached
+//============================================================
+bool Searcher::checkLimits(void)
+{
+	// Thread count could be changed during search
+	if (shared->requestedThreads.load(std::memory_order_relaxed) != shared->activeThreads.load(std::memory_order_relaxed))
+		shared->multiSearcher->adjustActiveThreads(rootDepth);
+	if constexpr (TIME_CHECK_ENABLED)
+		if (shared->timeManager.isTimeLimited() && !shared->pondering.load(std::memory_order_relaxed)
+			&& elapsedTime() > shared->timeManager.getMaximum())
+		{
+			shared->stopSearch = true;
+			shared->timeout = true;
+			shared->stopCause = StopCause::TIMEOUT;
+			return true;
+		}
+	// Nodes limit is for all threads together
+	if (const uint64_t nodesLimit = shared->limits.nodes; nodesLimit != 0)
+	{
+		const uint64_t totalNodes = shared->totalNodes();
+		if (totalNodes >= nodesLimit)
+		{
+			shared->stopSearch = true;
+			shared->stopCause = StopCause::NODES_REACHED;
+			return true;
+		}
+		// Check more often as the limit comes closer (remaining nodes are shared by active threads)
+		limitsCheckCountdown = int(std::min<uint64_t>(limitsCheckCountdown,
+			(nodesLimit - totalNodes) / std::max(shared->activeThreads.load(std::memory_order_relaxed), 1u) + 1));
+	}
+	return false;
 }
 
 //============================================================
-// Get count of threads currently searching given move on given depth
+// Find root move entry of given move
 //============================================================
-int BlendXChess::Searcher::threadsSearching(Depth depth, Move move)
+RootMove& Searcher::findRootMove(Move move)
 {
-	int cnt = 0;
-	for (const auto& state : shared->rootSearchStates)
-		if (state.depth == depth && state.move.load() == move)
-			++cnt;
-	return cnt;
+	const auto it = std::find_if(rootMoves.begin(), rootMoves.end(),
+		[move](const RootMove& rootMove) { return rootMove.move == move; });
+	assert(it != rootMoves.end());
+	return *it;
 }
 
 //============================================================
@@ -204,13 +584,14 @@ bool Searcher::doMove(Move move, PositionInfo& pi)
 {
 	assert(pos.isValid());
 	assert(searchPly >= 0);
-	pos.doMove(move, pi);
-	if (pos.isAttacked(pos.pieceSq[opposite(pos.turn)][KING][0], pos.turn))
-	{
-		pos.undoMove(move, pi);
+	if (!pos.isLegal(move))
 		return false;
-	}
-	prevMoves[searchPly++] = move;
+	const Piece movedPiece = pos.board[move.from()];
+	pos.doMove(move, pi);
+	SearchStackEntry* const ss = stackAt(searchPly++);
+	ss->move = move;
+	ss->movedPiece = movedPiece;
+	ss->contHistory = &continuationHistory[movedPiece][move.to()];
 	return true;
 }
 
@@ -228,16 +609,29 @@ void Searcher::undoMove(Move move, const PositionInfo& pi)
 //============================================================
 // Update killer moves
 //============================================================
-void Searcher::updateKillers(int searchPly, Move bestMove)
+void Searcher::updateKillers(SearchStackEntry* ss, Move bestMove)
 {
 	// Check whether this potential killer is a new one
-	for (auto killer : killers[searchPly])
+	for (auto killer : ss->killers)
 		if (killer == bestMove)
 			return;
 	// If it's new, add it to killers (in front)
-	for (int i = 0; i < MAX_KILLERS_CNT - 1; ++i)
-		killers[searchPly][i + 1] = killers[searchPly][i];
-	killers[searchPly][0] = bestMove;
+	for (int i = MAX_KILLERS_CNT - 1; i > 0; --i)
+		ss->killers[i] = ss->killers[i - 1];
+	ss->killers[0] = bestMove;
+}
+
+//============================================================
+// Gravity-style update of continuation histories by previous one and two
+// moves. Entries saturate towards +-CONT_HISTORY_MAX instead of overflowing
+//============================================================
+void Searcher::updateContHistories(Piece pc, Square to, int bonus)
+{
+	// contHistory is nullptr for entries before the root
+	const SearchStackEntry* const ss = stackAt(searchPly);
+	for (int i = 1; i <= 2; ++i)
+		if ((ss - i)->contHistory)
+			updateStat((*(ss - i)->contHistory)[pc][to], bonus, CONT_HISTORY_MAX);
 }
 
 //============================================================
@@ -245,6 +639,7 @@ void Searcher::updateKillers(int searchPly, Move bestMove)
 //============================================================
 void Searcher::scoreMoves(MoveList& moveList) const
 {
+	const SearchStackEntry* const ss = stackAt(searchPly);
 	for (int i = 0; i < moveList.count(); ++i)
 	{
 		MLNode& moveNode = moveList[i];
@@ -252,15 +647,17 @@ void Searcher::scoreMoves(MoveList& moveList) const
 		moveNode.score = history[move.from()][move.to()];
 		if (pos.isCaptureMove(move))
 			moveNode.score += MS_CAPTURE_BONUS_VICTIM[getPieceType(pos.board[move.to()])]
-			+ MS_CAPTURE_BONUS_ATTACKER[getPieceType(pos.board[move.from()])];
+			+ MS_CAPTURE_BONUS_ATTACKER[getPieceType(pos.board[move.from()])]
+			+ MS_CAPTURE_HISTORY_MULT * captureHistory[pos.board[move.from()]][move.to()]
+				[getPieceType(pos.board[move.to()])];
 		//moveNode.score += MS_SEE_MULT * SEECapture(move.from(), move.to(), turn);
 		else
 		{
-			assert(searchPly == 0 || prevMoves[searchPly - 1] != MOVE_NONE);
-			if (searchPly > 0 && move == countermoves[prevMoves[searchPly - 1].from()]
-				[prevMoves[searchPly - 1].to()])
+			assert(searchPly == 0 || (ss - 1)->move != MOVE_NONE);
+			moveNode.score += contHistoryScore(pos.board[move.from()], move.to());
+			if (searchPly > 0 && move == countermoves[(ss - 1)->move.from()][(ss - 1)->move.to()])
 				moveNode.score += MS_COUNTERMOVE_BONUS;
-			for (auto killerMove : killers[searchPly])
+			for (auto killerMove : ss->killers)
 				if (move == killerMove)
 				{
 					moveNode.score += MS_KILLER_BONUS;
@@ -314,129 +711,138 @@ Score Searcher::SEECapture(Square from, Square to, Side by)
 }
 
 //============================================================
-// Top-level search function that implements iterative
-// deepening with aspiration windows
+// Top-level search function that implements iterative deepening
+// with aspiration windows (helpers added during search don't
+// start from the first iteration)
 //============================================================
-void Searcher::idSearch(Depth depth)
+void Searcher::idSearch(Depth depth, Depth startDepth)
 {
 	assert(options && transpositionTable && shared && threadLocal);
-	assert(this == &threadLocal->searcher);
+	assert(this == threadLocal->searcher.get());
 	// Setup search
-	Move bestMove = MOVE_NONE, move;
-	int bestScore(SCORE_ZERO); // int to avoid overflow
-	Score score;
-	PositionInfo prevState;
+	Move bestMove = MOVE_NONE;
+	int bestScore(SCORE_ZERO), score; // int to avoid overflow
 	searchPly = 0;
+	SearchStackEntry* const ss = stackAt(searchPly);
+	ss->staticEval = pos.isInCheck() ? Score(SCORE_NONE) : evaluate();
 	threadLocal->results.resDepth = 0;
+	threadLocal->results.bestMove = MOVE_NONE;
+	threadLocal->results.pvLength = 0;
+	counters.nodes = counters.ttHits = 0;
+	limitsCheckCountdown = 1; // First check adapts countdown to the nodes limit
+	rootDepth = startDepth;
+	// Decaying count of best move changes between iterations (for time management)
+	double bestMoveChanges = 0.0;
+	// Generate root moves (initially ordered by move scoring)
+	MoveList moveList;
+	pos.generateLegalMoves(moveList);
+	sortMoves(moveList);
+	rootMoves.clear();
+	for (int moveIdx = 0; moveIdx < moveList.count(); ++moveIdx)
+		rootMoves.emplace_back(moveList[moveIdx].move);
 	// For different positions different aspiration windows can do better
 	constexpr int aspirationDeltas[3] = { 25, 10, 40 };
 	const int aspirationDelta = aspirationDeltas[threadLocal->ID % 3];
 	// Iterative deepening
-	SharedInfo::RootSearchState& searchState = shared->rootSearchStates[threadLocal->ID];
-	for (Depth curDepth = 1; curDepth <= depth; ++curDepth)
+	for (Depth curDepth = startDepth; curDepth <= depth; ++curDepth)
 	{
-		// Best move and score of current iteration, assigned originally to previous' info
-		int curBestScore(bestScore);
-		Move curBestMove(bestMove);
-		searchState.depth = curDepth;
-		searchState.move = MOVE_NONE;
+		// Helper threads skip some depths (main thread searches all of them)
+		if (options->smpDepthSkipping && !isMainThread())
+		{
+			const int patternIdx = (threadLocal->ID - 1) % SMP_SKIP_PATTERN_SIZE;
+			if ((curDepth + pos.getGamePly() + SMP_SKIP_PHASE[patternIdx])
+				/ SMP_SKIP_SIZE[patternIdx] % 2)
+				continue;
+		}
+		rootDepth = curDepth;
+		// Previous iteration's scores become the secondary ordering key
+		for (RootMove& rootMove : rootMoves)
+		{
+			rootMove.prevScore = rootMove.score;
+			rootMove.score = SCORE_LOSE;
+		}
+		// Best move of previous iteration is searched first (and its PV is followed)
+		ss->followPV = true;
 		// Aspiration windows
-		int delta = aspirationDelta, alpha = curBestScore - delta, beta = curBestScore + delta;
+		int delta = aspirationDelta, alpha = bestScore - delta, beta = bestScore + delta;
 		while (true)
 		{
-			// Initialize move picking manager
-			MoveManager<true> moveManager(*this, curBestMove);
-			curBestScore = alpha;
-			// Test every move and choose the best one
-			bool pvSearch = true, firstMove = true;
-			while ((move = moveManager.next()) != MOVE_NONE)
-			{
-				// Defer this move if it's not deferred and enough threads are searching it on this depth
-				if (!firstMove && !moveManager.lastMoveDeferred()
-					&& threadsSearching(curDepth, move) > 0)
-				{
-					moveManager.defer(move);
-					continue;
-				}
-				// Do move (should be legal due to generation of legal ones)
-				searchState.move = move;
-				doMove(move, prevState);
-				// Principal variation search
-				if (pvSearch)
-					score = -pvs(curDepth - 1, -beta, -curBestScore);
-				else
-				{
-					score = -pvs(curDepth - 1, -curBestScore - 1, -curBestScore);
-					if (!shared->stopSearch && beta > score && score > curBestScore)
-						score = -pvs(curDepth - 1, -beta, -score);
-				}
-				// Undo move
-				undoMove(move, prevState);
-				searchState.move = MOVE_NONE;
-				firstMove = false;
-				// Timeout check
-				if (shared->stopSearch)
-					break;
-				// If this move was better than current best one, update best move and score
-				if (score > curBestScore)
-				{
-					pvSearch = false;
-					curBestScore = score;
-					curBestMove = move;
-					// If beta-cutoff occurs, stop search
-					if (curBestScore >= beta)
-					{
-						// Don't update history and killers while in aspiration window
-						// history[move.from()][move.to()] += curDepth * curDepth;
-						break;
-					}
-				}
-			}
-			// Timeout check
-			if (shared->stopSearch)
+			score = pvs<NodeType::ROOT>(curDepth, alpha, beta);
+			// Timeout (or retirement) check
+			if (searchAborted())
 				break;
-			// If bestScore is inside the window, it is final score
-			if (alpha < curBestScore && curBestScore < beta)
+			// Moves which got exact (or fail-high) score go first in the next search
+			std::stable_sort(rootMoves.begin(), rootMoves.end());
+			// If score is inside the window, it is final score
+			if (alpha < score && score < beta)
 				break;
 			// Update delta and aspiration window otherwise
 			delta <<= 1;
-			alpha = std::max<int>(curBestScore - delta, SCORE_LOSE);
-			beta = std::min<int>(curBestScore + delta, SCORE_WIN);
+			alpha = std::max<int>(score - delta, SCORE_LOSE);
+			beta = std::min<int>(score + delta, SCORE_WIN);
 		}
-		// Timeout check
-		if (shared->stopSearch)
+		// Timeout (or retirement) check
+		if (searchAborted())
 			break;
 		// Only if there was no forced search stop we should accept this
 		// iteration's best move and score as new best overall
-		bestMove = curBestMove;
-		bestScore = curBestScore;
+		const Move prevBestMove = bestMove;
+		const int scoreDrop = curDepth > 1 ? bestScore - score : 0;
+		bestMove = rootMoves.empty() ? MOVE_NONE : rootMoves.front().move;
+		bestScore = score;
+		bestMoveChanges = bestMoveChanges / 2 + (curDepth > 1 && bestMove != prevBestMove);
 		// Update thread's storage
 		threadLocal->results.resDepth = curDepth;
 		threadLocal->results.bestMove = bestMove;
 		threadLocal->results.score = bestScore;
+		if (!rootMoves.empty())
+		{
+			const RootMove& bestRootMove = rootMoves.front();
+			threadLocal->results.pvLength = bestRootMove.pvLength;
+			std::copy(bestRootMove.pv, bestRootMove.pv + bestRootMove.pvLength, threadLocal->results.pv);
+		}
 		// Update history and killers
 		if (!pos.isCaptureMove(bestMove))
 		{
-			updateKillers(searchPly, bestMove);
+			updateKillers(ss, bestMove);
 			history[bestMove.from()][bestMove.to()] += curDepth * curDepth;
 		}
 		// Send info to external event processer
 		if (isMainThread())
 			shared->processer(SearchEvent(SearchEventType::INFO,
-				{ threadLocal->results, shared->stats }));
+				{ threadLocal->results, shared->collectStats() }));
+		// Main thread decides whether there is enough time for the next iteration
+		if (isMainThread() && !rootMoves.empty() && !shared->pondering
+			&& shared->timeManager.stopIteration(elapsedTime(),
+			bestMoveChanges, scoreDrop, double(rootMoves.front().nodes) / std::max<uint64_t>(getNodes(), 1),
+			int(rootMoves.size())))
+		{
+			shared->stopSearch = true;
+			shared->timeout = true;
+			shared->stopCause = StopCause::TIMEOUT;
+			break;
+		}
 	}
+	// If search was stopped before the first iteration finished, still return a legal move
+	if (threadLocal->results.resDepth == 0 && !rootMoves.empty())
+		threadLocal->results.bestMove = rootMoves.front().move;
 }
 
 //============================================================
 // Internal AI logic
 // Quiescent search
 //============================================================
+template<NodeType NT>
 Score Searcher::quiescentSearch(Score alpha, Score beta)
 {
+	static_assert(NT != NodeType::ROOT, "Quiescent search can't be launched from root");
+	static constexpr bool PV_NODE = NT == NodeType::PV;
 	static constexpr Score DELTA_MARGIN = 400;
+	SearchStackEntry* const ss = stackAt(searchPly);
+	if constexpr (PV_NODE)
+		ss->pvLength = 0;
 	// Increment search nodes count
-	if constexpr (SEARCH_NODES_COUNT_ENABLED)
-		++shared->stats.visitedNodes;
+	ThreadCounters::increment(counters.nodes);
 	// Get stand-pat score
 	const Score standPat = evaluate();
 	// We assume there's always a move that will increase score, so if
@@ -458,6 +864,7 @@ Score Searcher::quiescentSearch(Score alpha, Score beta)
 	Score score;
 	PositionInfo prevState;
 	bool anyLegalMove = false, prune;
+	int searchedCount = 0;
 	for (int moveIdx = 0; moveIdx < moveList.count(); ++moveIdx)
 	{
 		move = moveList[moveIdx].move;
@@ -480,16 +887,27 @@ Score Searcher::quiescentSearch(Score alpha, Score beta)
 			continue;
 		}
 		// Quiescent search
-		score = -quiescentSearch(-beta, -alpha);
+		score = -quiescentSearch<NT>(-beta, -alpha);
+		++searchedCount;
 		// Undo move
 		undoMove(move, prevState);
 		// Update alpha
 		if (score > alpha)
 		{
 			alpha = score;
+			if constexpr (PV_NODE)
+				updatePV(ss, move);
 			// If beta-cutoff occurs, stop search
 			if (alpha >= beta)
+			{
+				if constexpr (CUTOFFS_COUNT_ENABLED)
+				{
+					++shared->stats.betaCutoffs;
+					if (searchedCount == 1)
+						++shared->stats.firstMoveCutoffs;
+				}
 				break;
+			}
 		}
 	}
 	// Return alpha
@@ -499,109 +917,463 @@ Score Searcher::quiescentSearch(Score alpha, Score beta)
 //============================================================
 // Internal AI logic (Principal Variation Search)
 // Get position score by searching with given depth
+// Node type is a template parameter, so that zero-window (non-PV) nodes
+// are compiled without PV bookkeeping and re-search logic, and root
+// specifics (legal move generation, deferring moves searched by other
+// threads, best move tracking) are present only in root instantiation
 //============================================================
+template<NodeType NT>
 Score Searcher::pvs(Depth depth, Score alpha, Score beta)
 {
-	// Time check (if it's enabled)
-	if constexpr (TIME_CHECK_ENABLED)
-		if ((++shared->timeCheckCounter) == TIME_CHECK_INTERVAL)
-		{
-			shared->timeCheckCounter = 0;
-			auto endTime = std::chrono::high_resolution_clock::now();
-			if (std::chrono::duration_cast<std::chrono::milliseconds>(endTime
-				- shared->startTime).count() > options->timeLimit)
-			{
-				shared->stopSearch = true;
-				shared->timeout = true;
-				shared->stopCause = StopCause::TIMEOUT;
-				return SCORE_ZERO;
-			}
-		}
+	static constexpr bool ROOT = NT == NodeType::ROOT;
+	static constexpr bool PV_NODE = NT != NodeType::NON_PV;
+	// Limits check. Only main thread does it, counting its own pvs calls,
+	// so that search threads don't write to any shared data for this
+	if (isMainThread() && --limitsCheckCountdown <= 0)
+	{
+		limitsCheckCountdown = TIME_CHECK_INTERVAL;
+		if (checkLimits())
+			return SCORE_ZERO;
+	}
+	assert(PV_NODE || beta - alpha == 1);
+	SearchStackEntry* const ss = stackAt(searchPly);
+	if constexpr (PV_NODE)
+		ss->pvLength = 0;
 	// If depth is zero, we should stop and begin quiescent search
-	if (depth == DEPTH_ZERO)
-		return quiescentSearch(alpha, beta);
+	if constexpr (!ROOT)
+		if (depth == DEPTH_ZERO)
+			return quiescentSearch<PV_NODE ? NodeType::PV : NodeType::NON_PV>(alpha, beta);
 	// Increment search nodes count
-	if constexpr (SEARCH_NODES_COUNT_ENABLED)
-		++shared->stats.visitedNodes;
+	ThreadCounters::increment(counters.nodes);
 	// Check for 50-rule draw
-	if (pos.info.rule50 >= 100)
+	if (!ROOT && pos.info.rule50 >= 100)
 		return SCORE_ZERO;
-	// Transposition table lookup
+	// Transposition table lookup (root moves are ordered by previous iterations instead)
 	const Score oldAlpha = alpha;
-	const TTEntry* ttEntry = transpositionTable->probe(pos.info.keyZobrist);
 	Move move, bestMove, ttMove = MOVE_NONE;
-	if (ttEntry != nullptr)
-	{
-		if (ttEntry->depth >= depth)
+	if constexpr (!ROOT)
+		if (const TTEntry* ttEntry = transpositionTable->probe(pos.info.keyZobrist); ttEntry != nullptr)
 		{
-			const Score ttScore = scoreFromTT(ttEntry->score);
-			if ((ttEntry->bound & BOUND_LOWER) && ttScore > alpha)
-				alpha = ttScore;
-			if ((ttEntry->bound & BOUND_UPPER) && ttScore < beta)
-				beta = ttScore;
-			if (alpha >= beta)
-				return alpha;
+			if (!PV_NODE && ttEntry->depth >= depth)
+			{
+				const Score ttScore = scoreFromTT(ttEntry->score);
+				if ((ttEntry->bound & BOUND_LOWER) && ttScore > alpha)
+					alpha = ttScore;
+				if ((ttEntry->bound & BOUND_UPPER) && ttScore < beta)
+					beta = ttScore;
+				if (alpha >= beta)
+					return alpha;
+			}
+			ttMove = ttEntry->move;
+			if constexpr (TT_HITS_COUNT_ENABLED)
+				ThreadCounters::increment(counters.ttHits);
 		}
-		ttMove = ttEntry->move;
-		if constexpr (TT_HITS_COUNT_ENABLED)
-			++shared->stats.ttHits;
-	}
+	// While following PV of previous iteration, its move is searched first
+	const bool followPV = PV_NODE && ss->followPV && searchPly < threadLocal->results.pvLength;
+	if (followPV)
+		ttMove = threadLocal->results.pv[searchPly];
 	PositionInfo prevState;
-	MoveManager moveManager(*this, ttMove);
+	MoveManager<ROOT> moveManager(*this, ttMove);
 	Score bestScore = SCORE_LOSE, score;
-	bool anyLegalMove = false, pvSearch = true;
+	bool anyLegalMove = false;
+	const bool inCheck = pos.isInCheck();
+	// Position is improving if static evaluation is better than two plies ago (unknown is treated as improving)
+	ss->staticEval = inCheck ? Score(SCORE_NONE) : evaluate();
+	const bool improving = !inCheck && ((ss - 2)->staticEval == SCORE_NONE
+		|| ss->staticEval > (ss - 2)->staticEval);
+	// Quiet moves and captures searched so far (they get history malus on cutoff)
+	Move quietsSearched[MoveList::MAX_MOVECNT], capturesSearched[MoveList::MAX_MOVECNT];
+	Piece quietPieces[MoveList::MAX_MOVECNT];
+	int moveCount = 0, quietCount = 0, captureCount = 0;
+	// Moves of interior nodes searched by several threads are marked, so that others can defer them
+	const bool markSearchingMoves = !ROOT && options->smpMode == SMPMode::LAZY
+		&& shared->activeThreads.load(std::memory_order_relaxed) > 1 && depth >= SEARCHING_DEFER_MIN_DEPTH;
+	// In Young Brothers Wait mode deep enough node can be split after its first move is searched
+	const bool canSplit = !ROOT && options->smpMode == SMPMode::YBWC
+		&& depth >= YBWC_MIN_SPLIT_DEPTH;
 	while ((move = moveManager.next()) != MOVE_NONE)
 	{
-		// Do move with legality check
-		if (!doMove(move, prevState))
+		// In root, defer this move if it's not deferred and some other thread is searching it now
+		if constexpr (ROOT)
+			if (moveCount > 0 && !moveManager.lastMoveDeferred()
+				&& threadsSearching(move) > 0)
+			{
+				moveManager.defer(move);
+				continue;
+			}
+		// In interior nodes do the same (ABDADA-style), unless too many moves are deferred
+		Key moveSearchingKey = 0;
+		if (markSearchingMoves)
+		{
+			moveSearchingKey = searchingKey(move);
+			if (moveCount > 0 && !moveManager.lastMoveDeferred()
+				&& isSearching(moveSearchingKey) && moveManager.defer(move))
+				continue;
+		}
+		const Piece movedPiece = pos.board[move.from()];
+		const PieceType captured = getPieceType(pos.board[move.to()]);
+		const bool quiet = captured == PT_NULL && move.type() == MT_NORMAL;
+		const int contScore = quiet ? contHistoryScore(movedPiece, move.to()) : 0;
+		// Continuation history pruning of late quiet moves in non-PV nodes. We prune only
+		// after some legal move is found, so mate and stalemate detection is unaffected
+		if (!PV_NODE && !inCheck && quiet && anyLegalMove && bestScore > SCORE_LOSE_MAX
+			&& depth <= CONT_HISTORY_PRUNING_DEPTH && contScore < -CONT_HISTORY_PRUNING_MARGIN * depth)
 			continue;
+		// Do move with legality check (root moves are generated legal)
+		const uint64_t nodesBefore = getNodes();
+		if constexpr (ROOT)
+		{
+			++shared->rootMoveSearchers[move.raw()];
+			doMove(move, prevState);
+		}
+		else if (!doMove(move, prevState))
+			continue;
+		if (moveSearchingKey)
+			markSearching(moveSearchingKey);
 		anyLegalMove = true;
-		// Principal variation search
-		if (pvSearch)
-			score = -pvs(depth - 1, -beta, -alpha);
-		else
+		++moveCount;
+		if constexpr (PV_NODE)
 		{
-			score = -pvs(depth - 1, -alpha - 1, -alpha);
-			if (!shared->stopSearch && beta > score && score > alpha)
-				score = -pvs(depth - 1, -beta, -score);
+			(ss + 1)->pvLength = 0;
+			(ss + 1)->followPV = followPV && move == ttMove;
 		}
+		score = searchMove<NT>(depth, alpha, beta, moveCount, quiet, contScore, inCheck, improving);
 		// Undo move
 		undoMove(move, prevState);
-		// Timeout check
-		if (shared->stopSearch)
+		if (moveSearchingKey)
+			unmarkSearching(moveSearchingKey);
+		RootMove* rootMove = nullptr;
+		if constexpr (ROOT)
+		{
+			--shared->rootMoveSearchers[move.raw()];
+			rootMove = &findRootMove(move);
+			rootMove->nodes += getNodes() - nodesBefore;
+		}
+		// Timeout (or cutoff above) check
+		if (searchAborted())
 			return SCORE_ZERO;
+		// Root move's score stays unknown unless it raises alpha
+		if constexpr (ROOT)
+			rootMove->score = SCORE_LOSE;
 		// Update bestScore
 		if (score > bestScore)
 		{
-			pvSearch = false;
 			bestScore = score;
 			bestMove = move;
 			// Update alpha
 			if (score > alpha)
 			{
 				alpha = score;
-				// Beta-cutoff
+				if constexpr (PV_NODE)
+					updatePV(ss, move);
+				if constexpr (ROOT)
+				{
+					rootMove->score = score;
+					rootMove->pvLength = ss->pvLength;
+					std::copy(ss->pv, ss->pv + ss->pvLength, rootMove->pv);
+				}
+				// Beta-cutoff (in root it means failing high of aspiration
+				// window, so history and killers are not updated)
 				if (alpha >= beta)
 				{
-					// Update killers, countermoves and history
-					if (!pos.isCaptureMove(move))
+					if constexpr (!ROOT)
 					{
-						updateKillers(searchPly, move);
-						history[move.from()][move.to()] += depth * depth;
-						countermoves[prevMoves[searchPly - 1].from()][
-							prevMoves[searchPly - 1].to()] = move;
+						// Update killers, countermoves and history
+						if (!pos.isCaptureMove(move))
+						{
+							updateKillers(ss, move);
+							history[move.from()][move.to()] += depth * depth;
+							countermoves[(ss - 1)->move.from()][(ss - 1)->move.to()] = move;
+						}
+						// Reward the cutoff move and penalize moves which failed before it
+						const int bonus = historyBonus(depth);
+						if (quiet)
+						{
+							updateContHistories(movedPiece, move.to(), bonus);
+							for (int i = 0; i < quietCount; ++i)
+								updateContHistories(quietPieces[i], quietsSearched[i].to(), -bonus);
+						}
+						else if (captured != PT_NULL)
+							updateCaptureHistory(movedPiece, move.to(), captured, bonus);
+						for (int i = 0; i < captureCount; ++i)
+							updateCaptureHistory(pos.board[capturesSearched[i].from()], capturesSearched[i].to(),
+								getPieceType(pos.board[capturesSearched[i].to()]), -bonus);
+						if constexpr (CUTOFFS_COUNT_ENABLED)
+						{
+							++shared->stats.betaCutoffs;
+							if (moveCount == 1)
+								++shared->stats.firstMoveCutoffs;
+						}
 					}
 					// Cutoff
 					break;
 				}
 			}
 		}
+		if (quiet)
+		{
+			quietsSearched[quietCount] = move;
+			quietPieces[quietCount++] = movedPiece;
+		}
+		else if (captured != PT_NULL)
+			capturesSearched[captureCount++] = move;
+		// Young Brothers Wait: after the eldest brother is searched, the rest may be searched in parallel
+		if constexpr (!ROOT)
+			if (canSplit && shared->idleHelpers.load(std::memory_order_relaxed) > 0
+				&& split<NT>(depth, alpha, beta, bestScore, bestMove, moveCount, moveManager, inCheck, improving))
+			{
+				if (searchAborted())
+					return SCORE_ZERO;
+				// Only the best move is rewarded, since moves searched by helpers are unknown here
+				if (alpha >= beta && !pos.isCaptureMove(bestMove))
+				{
+					updateKillers(ss, bestMove);
+					history[bestMove.from()][bestMove.to()] += depth * depth;
+					countermoves[(ss - 1)->move.from()][(ss - 1)->move.to()] = bestMove;
+				}
+				break;
+			}
 	}
 	// Save collected info to the transposition table
-	if (anyLegalMove)
+	if (!ROOT && anyLegalMove)
 		transpositionTable->store(pos.info.keyZobrist, depth, alpha == oldAlpha ? BOUND_UPPER :
 			alpha < beta ? BOUND_EXACT : BOUND_LOWER, scoreToTT(bestScore),
 			bestMove); // ! NOT searchPly !
 	// Return alpha
 	return anyLegalMove ? alpha : pos.isInCheck() ? SCORE_LOSE + searchPly : SCORE_ZERO;
-}
\ No newline at end of file
+}
+
+//============================================================
+// Searches the child after the move with given number is made at a node
+// of given type, using late move reductions and re-searches if needed
+//============================================================
+template<NodeType NT>
+Score Searcher::searchMove(Depth depth, Score alpha, Score beta, int moveCount,
+	bool quiet, int contScore, bool inCheck, bool improving)
+{
+	static constexpr bool ROOT = NT == NodeType::ROOT;
+	static constexpr bool PV_NODE = NT != NodeType::NON_PV;
+	// Principal variation search
+	if (PV_NODE && moveCount == 1)
+		return -pvs<NodeType::PV>(depth - 1, -beta, -alpha);
+	// Late move reductions of quiet moves, adjusted by continuation history
+	int reduction = 0;
+	if (!ROOT && quiet && depth >= LMR_MIN_DEPTH && moveCount > LMR_MIN_MOVE_COUNT
+		&& !inCheck && !pos.isInCheck())
+	{
+		reduction = 1 + (moveCount > 2 * LMR_MIN_MOVE_COUNT) + !improving - PV_NODE
+			- contScore / LMR_HISTORY_DIV;
+		reduction = std::clamp(reduction, 0, depth - 2);
+	}
+	Score score = -pvs<NodeType::NON_PV>(depth - 1 - reduction, -alpha - 1, -alpha);
+	if (!searchAborted() && reduction > 0 && score > alpha)
+		score = -pvs<NodeType::NON_PV>(depth - 1, -alpha - 1, -alpha);
+	if constexpr (PV_NODE)
+		if (!searchAborted() && beta > score && score > alpha)
+			score = -pvs<NodeType::PV>(depth - 1, -beta, -alpha);
+	return score;
+}
+
+//============================================================
+// Young Brothers Wait
+// Splits current node, so that idle helper threads join searching its
+// remaining moves, and updates alpha, best score and move with the results
+// Returns false if no helper joined (then the node should be searched
+// further by this thread alone)
+//============================================================
+template<NodeType NT>
+bool Searcher::split(Depth depth, Score& alpha, Score beta, Score& bestScore, Move& bestMove,
+	int moveCount, MoveManager<false>& moveManager, bool inCheck, bool improving)
+{
+	static_assert(NT != NodeType::ROOT, "Root node isn't split");
+	SplitPoint sp;
+	sp.parent = splitPoint;
+	sp.pos = pos;
+	sp.ply = searchPly;
+	std::copy(stackAt(searchPly - 2), stackAt(searchPly) + 1, sp.stack);
+	sp.nodeType = NT;
+	sp.depth = depth;
+	sp.beta = beta;
+	sp.inCheck = inCheck;
+	sp.improving = improving;
+	sp.moveManager = &moveManager;
+	sp.alpha = alpha;
+	sp.bestScore = bestScore;
+	sp.bestMove = bestMove;
+	sp.moveCount = moveCount;
+	sp.helperCount = 0;
+	sp.pvLength = 0;
+	sp.cutoff = false;
+	// Position will be changed by this thread while others take moves
+	moveManager.generateRemaining();
+	// Book idle helpers (booked ones may finish before the count is checked, so it's kept separately)
+	int helpersBooked = 0;
+	{
+		std::lock_guard<std::mutex> splitLock(shared->splitMutex);
+		std::lock_guard<std::mutex> lock(sp.mutex);
+		for (ThreadInfo& threadInfo : *shared->threads)
+			if (threadInfo.idle && helpersBooked < YBWC_MAX_HELPERS)
+			{
+				threadInfo.idle = false;
+				--shared->idleHelpers;
+				++helpersBooked;
+				{
+					std::lock_guard<std::mutex> threadLock(threadInfo.mutex);
+					threadInfo.splitPoint = &sp;
+				}
+				threadInfo.wakeCondition.notify_all();
+			}
+		sp.helperCount = helpersBooked;
+	}
+	if (helpersBooked == 0)
+		return false;
+	// Master searches moves of the split point too and then waits for helpers
+	splitPoint = &sp;
+	searchSplitPoint(sp);
+	{
+		std::unique_lock<std::mutex> lock(sp.mutex);
+		while (sp.helperCount > 0)
+		{
+			sp.helpersDone.wait_for(lock, std::chrono::milliseconds(YBWC_LIMITS_CHECK_INTERVAL));
+			// Search limits are still checked by main thread
+			if (isMainThread() && sp.helperCount > 0)
+			{
+				lock.unlock();
+				checkLimits();
+				lock.lock();
+			}
+		}
+	}
+	splitPoint = sp.parent;
+	// Collect results
+	alpha = sp.alpha;
+	bestScore = sp.bestScore;
+	bestMove = sp.bestMove;
+	if constexpr (NT == NodeType::PV)
+		if (sp.pvLength > 0)
+		{
+			SearchStackEntry* const ss = stackAt(searchPly);
+			ss->pvLength = sp.pvLength;
+			std::copy(sp.pv, sp.pv + sp.pvLength, ss->pv);
+		}
+	return true;
+}
+
+//============================================================
+// Young Brothers Wait
+// Searches moves of given split point until none is left or a cutoff occurs
+//============================================================
+void Searcher::searchSplitPoint(SplitPoint& sp)
+{
+	const bool PV_NODE = sp.nodeType == NodeType::PV;
+	SearchStackEntry* const ss = stackAt(sp.ply);
+	PositionInfo prevState;
+	Move move;
+	Score alpha, bestScore, score;
+	int moveCount;
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sp.mutex);
+			if (searchAborted() || (move = sp.moveManager->next()) == MOVE_NONE)
+				break;
+			// Pseudo-legal move is counted, so that the number is known before it's made
+			moveCount = ++sp.moveCount;
+			alpha = sp.alpha;
+			bestScore = sp.bestScore;
+		}
+		const Piece movedPiece = pos.board[move.from()];
+		const bool quiet = pos.board[move.to()] == PIECE_NULL && move.type() == MT_NORMAL;
+		const int contScore = quiet ? contHistoryScore(movedPiece, move.to()) : 0;
+		// Continuation history pruning as in pvs (some legal move is already searched)
+		if (!PV_NODE && !sp.inCheck && quiet && bestScore > SCORE_LOSE_MAX
+			&& sp.depth <= CONT_HISTORY_PRUNING_DEPTH && contScore < -CONT_HISTORY_PRUNING_MARGIN * sp.depth)
+			continue;
+		if (!doMove(move, prevState))
+			continue;
+		if (PV_NODE)
+		{
+			(ss + 1)->pvLength = 0;
+			(ss + 1)->followPV = false;
+			score = searchMove<NodeType::PV>(sp.depth, alpha, sp.beta, moveCount,
+				quiet, contScore, sp.inCheck, sp.improving);
+		}
+		else
+			score = searchMove<NodeType::NON_PV>(sp.depth, alpha, sp.beta, moveCount,
+				quiet, contScore, sp.inCheck, sp.improving);
+		undoMove(move, prevState);
+		if (searchAborted())
+			break;
+		std::lock_guard<std::mutex> lock(sp.mutex);
+		if (score > sp.bestScore)
+		{
+			sp.bestScore = score;
+			sp.bestMove = move;
+			if (score > sp.alpha)
+			{
+				sp.alpha = score;
+				if (PV_NODE)
+				{
+					updatePV(ss, move);
+					sp.pvLength = ss->pvLength;
+					std::copy(ss->pv, ss->pv + ss->pvLength, sp.pv);
+				}
+				if (score >= sp.beta)
+					sp.cutoff = true;
+			}
+		}
+	}
+}
+
+//============================================================
+// Loop of a helper thread in Young Brothers Wait mode: searches
+// moves of split points it's assigned to until the search ends
+//============================================================
+void Searcher::splitPointLoop(void)
+{
+	ThreadInfo& threadInfo = *threadLocal;
+	counters.nodes = counters.ttHits = 0;
+	while (!threadInfo.retire)
+	{
+		{
+			std::lock_guard<std::mutex> splitLock(shared->splitMutex);
+			threadInfo.idle = true;
+			++shared->idleHelpers;
+		}
+		{
+			std::unique_lock<std::mutex> lock(threadInfo.mutex);
+			threadInfo.wakeCondition.wait(lock, [this, &threadInfo] {
+				return threadInfo.splitPoint || shared->stopSearch || threadInfo.retire; });
+		}
+		// If woken by the search end (or retirement), leave unless some split point has booked this thread meanwhile
+		// (its master sets splitPoint under the split mutex, so it's visible after locking it)
+		{
+			std::lock_guard<std::mutex> splitLock(shared->splitMutex);
+			if (threadInfo.idle)
+			{
+				threadInfo.idle = false;
+				--shared->idleHelpers;
+				return;
+			}
+		}
+		SplitPoint& sp = *threadInfo.splitPoint;
+		threadInfo.splitPoint = nullptr;
+		// Take the node state from master (continuation history entries are of this thread)
+		pos = sp.pos;
+		searchPly = sp.ply;
+		for (int i = 0; i < 3; ++i)
+		{
+			SearchStackEntry* const entry = stackAt(sp.ply - 2 + i);
+			*entry = sp.stack[i];
+			if (entry->contHistory)
+				entry->contHistory = &continuationHistory[entry->movedPiece][entry->move.to()];
+		}
+		splitPoint = &sp;
+		searchSplitPoint(sp);
+		splitPoint = nullptr;
+		// Master may destroy the split point as soon as it sees no helpers, so notify under lock
+		std::lock_guard<std::mutex> lock(sp.mutex);
+		if (--sp.helperCount == 0)
+			sp.helpersDone.notify_one();
+	}
+}
@@ -8,11 +8,17 @@
 #define _SEARCHER_H
 #include "position.h"
 #include "transtable.h"
+#include "timeman.h"
+#include "numa.h"
 #include <list>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <deque>
+#include <memory>
+#include <algorithm>
 
 namespace BlendXChess
 {
@@ -20,13 +26,15 @@ namespace BlendXChess
 #if defined(_DEBUG) | defined(DEBUG)
 	constexpr bool SEARCH_NODES_COUNT_ENABLED = true;
 	constexpr bool TT_HITS_COUNT_ENABLED = true;
+	constexpr bool CUTOFFS_COUNT_ENABLED = true;
 	constexpr bool TIME_CHECK_ENABLED = true;
 #else
 	constexpr bool SEARCH_NODES_COUNT_ENABLED = true;
 	constexpr bool TT_HITS_COUNT_ENABLED = true;
+	constexpr bool CUTOFFS_COUNT_ENABLED = false;
 	constexpr bool TIME_CHECK_ENABLED = true;
 #endif
-	constexpr unsigned int TIME_CHECK_INTERVAL = 10000; // nodes entered by pvs
+	constexpr unsigned int TIME_CHECK_INTERVAL = 4096; // pvs nodes of main thread between limits checks
 	constexpr unsigned int TIME_LIMIT_DEFAULT = 5000; // ms
 	constexpr unsigned int TIME_LIMIT_MIN = 100; // ms
 	constexpr unsigned int TIME_LIMIT_MAX = 1000000; // ms
@@ -34,6 +42,29 @@ namespace BlendXChess
 	constexpr Depth SEARCH_DEPTH_MIN = 1;
 	constexpr Depth SEARCH_DEPTH_MAX = 60;
 	constexpr unsigned int THREAD_COUNT_MIN = 1;
+	constexpr size_t CACHE_LINE_SIZE = 64;
+	// Lazy SMP depth skipping (if enabled by search option): helper thread with index i (from 1) in
+	// a pattern skips iterations where (depth + gamePly + SMP_SKIP_PHASE[i]) / SMP_SKIP_SIZE[i] is odd,
+	// so that helpers are spread across different depths. The pattern itself is fixed, since it only
+	// has to cover skip sizes and phases evenly, and there is nothing to tune in it per machine
+	constexpr int SMP_SKIP_PATTERN_SIZE = 20;
+	constexpr int SMP_SKIP_SIZE[SMP_SKIP_PATTERN_SIZE] = {
+		1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+	constexpr int SMP_SKIP_PHASE[SMP_SKIP_PATTERN_SIZE] = {
+		0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+	// Size of the table of (position, move) pairs currently searched in interior nodes
+	constexpr int SEARCHING_TABLE_BITS = 12;
+	constexpr int SEARCHING_TABLE_SIZE = 1 << SEARCHING_TABLE_BITS;
+	constexpr Key SEARCHING_TABLE_MASK = SEARCHING_TABLE_SIZE - 1;
+	// Count of possible move encodings (for tables indexed by whole move)
+	constexpr int MOVE_ENCODING_CNT = 1 << (8 * sizeof(MoveRaw));
+	// Young Brothers Wait: nodes of at least this depth are split after their first
+	// move is searched, and at most this many idle helper threads join each of them
+	constexpr Depth YBWC_MIN_SPLIT_DEPTH = 4;
+	constexpr int YBWC_MAX_HELPERS = 4;
+	constexpr unsigned int YBWC_LIMITS_CHECK_INTERVAL = 1; // ms, while main thread waits for helpers
+	// Vote of a thread for its best move is weighted by (score - minimal score + this) * completed depth
+	constexpr int BEST_THREAD_VOTE_SCORE_OFFSET = 14;
 
 	//============================================================
 	// Structs for storing results and stats of search returned by endSearch
@@ -43,21 +74,54 @@ namespace BlendXChess
 	{
 		Score score;
 		Depth resDepth;
-		Move bestMove; // !! TODO (PV?) !!
+		Move bestMove;
+		int pvLength;
+		Move pv[MAX_SEARCH_PLY]; // Principal variation (pv[0] is bestMove)
 	};
 
+	//============================================================
+	// Root move with info collected by previous iterations of search
+	//============================================================
+
+	struct RootMove
+	{
+		inline RootMove(Move move)
+			: move(move), score(SCORE_LOSE), prevScore(SCORE_LOSE), nodes(0), pvLength(0)
+		{}
+		// Ordering for the next iteration: exact score of current iteration, then of the
+		// previous one, then size of the subtree (moves which failed low have SCORE_LOSE)
+		inline bool operator<(const RootMove& rhs) const
+		{
+			return score != rhs.score ? score > rhs.score
+				: prevScore != rhs.prevScore ? prevScore > rhs.prevScore : nodes > rhs.nodes;
+		}
+		Move move;
+		Score score; // Exact score in current iteration (SCORE_LOSE if unknown)
+		Score prevScore; // Exact score in previous iteration (SCORE_LOSE if unknown)
+		uint64_t nodes; // Nodes spent on the subtree of this move during whole search
+		int pvLength;
+		Move pv[MAX_SEARCH_PLY]; // Principal variation starting with this move
+	};
+
+	typedef std::vector<RootMove> RootMoves;
+
 	struct SearchStats
 	{
-		std::atomic<int> ttHits;
-		std::atomic<int> visitedNodes;
+		std::atomic<uint64_t> ttHits;
+		std::atomic<uint64_t> visitedNodes;
+		std::atomic<int> betaCutoffs; // Count of beta-cutoffs (in pvs and quiescent search)
+		std::atomic<int> firstMoveCutoffs; // Count of beta-cutoffs produced by the first searched move
 		inline SearchStats(void) = default;
 		inline SearchStats(const SearchStats& rhs)
-			: ttHits(rhs.ttHits.load()), visitedNodes(rhs.visitedNodes.load())
+			: ttHits(rhs.ttHits.load()), visitedNodes(rhs.visitedNodes.load()),
+			betaCutoffs(rhs.betaCutoffs.load()), firstMoveCutoffs(rhs.firstMoveCutoffs.load())
 		{}
 		inline SearchStats& operator=(const SearchStats& rhs)
 		{
 			ttHits = rhs.ttHits.load();
 			visitedNodes = rhs.visitedNodes.load();
+			betaCutoffs = rhs.betaCutoffs.load();
+			firstMoveCutoffs = rhs.firstMoveCutoffs.load();
 			return *this;
 		}
 	};
@@ -88,50 +152,86 @@ namespace BlendXChess
 	// Structs for storing some shared search options and info
 	//============================================================
 
+	// Parallel search algorithm used when there are several threads
+	enum class SMPMode {
+		LAZY, // Lazy SMP: all threads search from the root, sharing the transposition table
+		YBWC // Young Brothers Wait: main thread searches from the root, helpers join split nodes
+	};
+
 	struct SearchOptions
 	{
-		unsigned int timeLimit; // ms
+		unsigned int timeLimit; // ms (used when search limits are not given)
 		unsigned int threadCount;
-		Depth depth;
+		Depth depth; // Used when search limits are not given
+		TimeMs moveOverhead; // ms, reserved for communication delays on each move
+		SMPMode smpMode;
+		bool smpDepthSkipping; // Whether Lazy SMP helpers skip some depths
+		bool numaPinning; // Whether search threads are bound to NUMA nodes
 	};
 
 	const SearchOptions DEFAULT_SEARCH_OPTIONS = SearchOptions{
-		TIME_LIMIT_DEFAULT, std::thread::hardware_concurrency(), SEARCH_DEPTH_DEFAULT };
+		TIME_LIMIT_DEFAULT, std::thread::hardware_concurrency(), SEARCH_DEPTH_DEFAULT, MOVE_OVERHEAD_DEFAULT,
+		SMPMode::LAZY, true, false };
 
 	typedef std::chrono::time_point<std::chrono::high_resolution_clock> TimePoint;
 
 	enum class StopCause {
-		END_SEARCH_CALL, TIMEOUT, DEPTH_REACHED
+		END_SEARCH_CALL, TIMEOUT, DEPTH_REACHED, NODES_REACHED
+	};
+
+	// Types of nodes in search tree. Non-PV nodes are searched with zero window
+	enum class NodeType {
+		ROOT, PV, NON_PV
 	};
 
+	struct ThreadInfo;
+	struct SplitPoint;
+	class MultiSearcher;
+	typedef std::deque<ThreadInfo> ThreadList; // deque, so that elements are never moved
+
 	struct SharedInfo
 	{
-		struct RootSearchState
-		{
-			std::atomic_int depth = DEPTH_ZERO;
-			std::atomic<Move> move;
-		};
 		TimePoint startTime; // read-only while accessed multithreaded, thus not atomic
-		SearchStats stats;
-		std::atomic_int timeCheckCounter;
+		SearchLimits limits; // read-only while accessed multithreaded
+		TimeManager timeManager; // read-only while accessed multithreaded
+		SearchStats stats; // Node and TT hit counts are collected from threads on demand
+		ThreadList* threads; // All pool threads (for collecting their counters and booking helpers)
+		MultiSearcher* multiSearcher; // Owner (main search thread applies thread count changes through it)
+		// Count of threads taking part in search and count requested by setThreadCount during search
+		std::atomic<unsigned int> activeThreads;
+		std::atomic<unsigned int> requestedThreads;
 		std::atomic_bool stopSearch;
 		std::atomic_bool externalStop;
 		std::atomic_bool timeout;
-		// States of search in the root of a thread with corrersponding ID
-		std::deque<RootSearchState> rootSearchStates;
-		// Count of threads search(-ing/-ed) specified depth (from root position)
-		// std::deque<std::atomic_int> depthSearchedByCnt;
+		// Whether search is pondering (its time isn't counted until ponderhit)
+		std::atomic_bool pondering;
+		// Time spent pondering before ponderhit (limits are checked against time after it)
+		std::atomic<TimeMs> ponderTime;
+		// Main search thread waits on these when infinite or pondering search finishes
+		// before it's stopped (or before ponderhit), so that result isn't reported early
+		std::mutex finishMutex;
+		std::condition_variable finishCondition;
+		// Count of threads currently searching root move by its full encoding (there are
+		// never so many threads that 16 bits overflow, and the table stays 128 KB)
+		std::atomic<uint16_t> rootMoveSearchers[MOVE_ENCODING_CNT];
+		// ABDADA-style lock-free table of (position, move) pairs currently searched in
+		// interior nodes, indexed and tagged by the pair key (0 for empty slot)
+		std::atomic<Key> searchingMoves[SEARCHING_TABLE_SIZE];
+		// Young Brothers Wait: guards booking of idle helper threads by split points
+		std::mutex splitMutex;
+		std::atomic<int> idleHelpers; // Count of helper threads waiting for a split point
 		StopCause stopCause;
 		EngineProcesser processer; // External search event processer
+		// Sums per-thread counters
+		inline uint64_t totalNodes(void) const;
+		// Search stats with per-thread counters collected
+		inline SearchStats collectStats(void);
 	};
 
 	//============================================================
 	// Class for organizing potentially multi-threaded search process
 	//============================================================
 
-	struct ThreadInfo;
-	typedef std::vector<ThreadInfo> ThreadList;
-
 	class MultiSearcher
 	{
 	public:
@@ -144,20 +244,42 @@ namespace BlendXChess
 		inline const SearchOptions& getOptions(void) const;
 		inline bool isInSearch(void) const;
 		// Setters
-		inline void setThreadCount(unsigned int);
+		void setThreadCount(unsigned int);
 		inline void setTimeLimit(unsigned int);
 		inline void setDepth(Depth);
+		inline void setMoveOverhead(TimeMs);
+		inline void setSMPMode(SMPMode);
+		inline void setSMPDepthSkipping(bool);
+		void setNumaPinning(bool);
 		inline void setOptions(const SearchOptions&);
 		// Setup external search event processer
 		inline void setProcesser(const EngineProcesser&);
-		// Starts search with given depth
-		void startSearch(const Position&);
+		// Clear history tables of all search threads (typically when new game starts)
+		void clearHistory(void);
+		// Starts search with given limits (options are used if limits are empty)
+		void startSearch(const Position&, const SearchLimits& = SearchLimits());
 		// Ends started search and returns search information
 		// Returns last search results if no one is performed at the moment
 		SearchReturn endSearch(void);
-		// Internal search logic (coordinates searching process, launches Searcher threads)
+		// Switches pondering search to normal one (time starts being counted)
+		void ponderHit(void);
+		// Internal search logic (coordinates searching process, wakes Searcher threads)
 		void search(void);
+		// Adds or retires helpers if thread count was changed during search (called by
+		// main search thread, new helpers start iterative deepening from given depth)
+		void adjustActiveThreads(Depth);
+		// Selects the best of given search results of threads by voting for best moves
+		// Returns index of the selected results
+		static size_t voteBestResults(const std::vector<SearchResults>&);
 	private:
+		// Starts or terminates pool threads so that there are given count of them
+		void resizeThreadPool(unsigned int);
+		// Loop of a pool thread: sets itself up, then sleeps until woken to search or terminated
+		void idleLoop(ThreadInfo&);
+		// Wakes given pool thread to search
+		static void wakeThread(ThreadInfo&);
+		// Waits until given pool thread finishes its search
+		static void waitThread(ThreadInfo&);
 		// Helper setter method
 		template<typename T>
 		inline void clampSetter(T&, T, T, const std::string&, T, const std::string&);
@@ -174,8 +296,10 @@ namespace BlendXChess
 		// Position
 		Position pos;
 		// Search threads info by index (main search thread has index 0)
-		// Main search thread searches itself and launches/coordinates other threads
-		std::vector<ThreadInfo> threads;
+		// Main search thread searches itself and wakes/coordinates other threads
+		// Threads persist between searches and are parked while idle
+		// During search the list is changed only by main search thread (under split mutex)
+		ThreadList threads;
 		// Whether search is currently launched
 		std::atomic_bool inSearch;
 		// Maximum thread count
@@ -204,23 +328,97 @@ namespace BlendXChess
 		static constexpr MoveScore MS_CAPTURE_BONUS_ATTACKER[PIECETYPE_CNT] = {
 			0, 1000000, 800000, 750000, 400000, 200000 };
 		static constexpr MoveScore MS_KILLER_BONUS = 1200000;
+		// Bounds of continuation and capture history entries (gravity-style updates keep them inside)
+		static constexpr int CONT_HISTORY_MAX = 16384;
+		static constexpr int CAPTURE_HISTORY_MAX = 16384;
+		static constexpr MoveScore MS_CAPTURE_HISTORY_MULT = 8;
+		// Non-first moves at interior nodes of at least this depth are deferred if another thread searches them
+		static constexpr Depth SEARCHING_DEFER_MIN_DEPTH = 3;
+		// Late move reductions parameters
+		static constexpr Depth LMR_MIN_DEPTH = 3;
+		static constexpr int LMR_MIN_MOVE_COUNT = 4;
+		static constexpr int LMR_HISTORY_DIV = 8192;
+		// Continuation history pruning parameters (non-PV nodes only)
+		static constexpr Depth CONT_HISTORY_PRUNING_DEPTH = 3;
+		static constexpr int CONT_HISTORY_PRUNING_MARGIN = 4000;
+		// Count of entries before the root in search stack (so that ancestors of root can be referenced)
+		static constexpr int SEARCH_STACK_OFFSET = 2;
 		using KillerList = Move[MAX_KILLERS_CNT];
+		// Continuation history subtable for a fixed previous (piece, to) pair
+		using PieceToHistory = int16_t[PIECE_CNT][SQUARE_CNT];
+		// Per-ply search state. Entries are contiguous, so heuristics can read
+		// data of ancestors (and the child) of current ply in O(1)
+		struct SearchStackEntry
+		{
+			Move move; // Move made from this ply
+			Piece movedPiece; // Piece which made that move
+			Score staticEval; // SCORE_NONE if side to move is in check
+			KillerList killers;
+			PieceToHistory* contHistory; // Continuation history subtable for (movedPiece, move.to())
+			bool followPV; // Whether the path to this ply follows PV of previous iteration
+			int pvLength;
+			Move pv[MAX_SEARCH_PLY]; // Principal variation from this ply (valid only in PV nodes)
+		};
+		// Counters which are read by other threads, kept on a separate cache line
+		struct alignas(CACHE_LINE_SIZE) ThreadCounters
+		{
+			std::atomic<uint64_t> nodes;
+			std::atomic<uint64_t> ttHits;
+			// Increment by the owner thread (the only writer, so no atomic read-modify-write is needed)
+			static inline void increment(std::atomic<uint64_t>& counter)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		};
+		// History tables are divided by this on each new search
+		static constexpr int HISTORY_AGING_DIV = 4;
 		// Default constructor
-		Searcher(void) = default;
-		// Constructor
-		Searcher(const Position&, SearchOptions*, SharedInfo*, TranspositionTable*, ThreadInfo*);
-		// Initializer
+		Searcher(void);
+		// Initializer (should be called before each search and on reactivation during search)
 		void initialize(const Position&, SearchOptions*, SharedInfo*, TranspositionTable*, ThreadInfo*);
-		// Top-level search function that implements iterative deepening with aspiration windows
-		void idSearch(Depth);
+		// Scale history tables down before new search (once per search, so that
+		// helpers reactivated during the search don't lose their history)
+		void ageHistory(void);
+		// Clear history tables (typically when new game starts)
+		void clearHistory(void);
+		// Copy history tables from given searcher (when searchers are reallocated)
+		void copyHistory(const Searcher&);
+		// Top-level search function that implements iterative deepening with aspiration
+		// windows (up to the first given depth, starting from the second one)
+		void idSearch(Depth, Depth = 1);
+		// Loop of a helper thread in Young Brothers Wait mode: searches moves
+		// of split points it's assigned to until the search ends
+		void splitPointLoop(void);
 		// Whether this search thread is the main one
 		inline bool isMainThread(void) const;
+		// Root moves ordered by results of the last searched iteration, with node counts of their subtrees
+		inline const RootMoves& getRootMoves(void) const noexcept;
+		// Nodes visited by this thread in current search
+		inline uint64_t getNodes(void) const noexcept;
+		// Transposition table hits made by this thread in current search
+		inline uint64_t getTTHits(void) const noexcept;
 	private:
 		// Helpers for ply-adjustment of scores (mate ones) when (extracted from)/(inserted to) a transposition table
 		inline Score scoreToTT(Score) const;
 		inline Score scoreFromTT(Score) const;
-		// Get count of threads currently searching given move on given depth
-		int threadsSearching(Depth, Move);
+		// Get count of threads currently searching given root move (at any depth)
+		inline int threadsSearching(Move) const;
+		// Key of given move (its full encoding) from current position in the table of moves searched in interior nodes
+		inline Key searchingKey(Move) const;
+		// Whether (position, move) pair with given key is currently searched by some thread
+		inline bool isSearching(Key) const;
+		// Mark (position, move) pair with given key as currently searched or not
+		inline void markSearching(Key);
+		inline void unmarkSearching(Key);
+		// Whether current search should be abandoned (the whole search is stopped,
+		// a cutoff occurred in some split point above or Lazy SMP helper retires)
+		inline bool searchAborted(void) const;
+		// Find root move entry of given move
+		RootMove& findRootMove(Move);
+		// Time elapsed since the search start (not counting time spent pondering)
+		inline TimeMs elapsedTime(void) const;
+		// Checks time and nodes limits, signals search stop and returns true if some of them is reached
+		bool checkLimits(void);
 		// Performs given move if legal on pos and updates necessary info
 		// Returns false if the move is illegal, otherwise
 		// returns true and fills position info for undo
@@ -229,7 +427,21 @@ namespace BlendXChess
 		void undoMove(Move, const PositionInfo&);
 		// Internal AI logic (Principal Variation Search)
 		// Gets position score by searching with given depth and alpha-beta window
+		template<NodeType NT>
 		Score pvs(Depth, Score, Score);
+		// Searches the child after the move with given number is made at a node
+		// of given type, using late move reductions and re-searches if needed
+		template<NodeType NT>
+		Score searchMove(Depth, Score alpha, Score beta, int moveCount,
+			bool quiet, int contScore, bool inCheck, bool improving);
+		// Splits current node, so that idle helper threads join searching its remaining moves,
+		// and updates alpha, best score and move with the results. Returns false if no helper
+		// joined (then the node should be searched further by this thread alone)
+		template<NodeType NT>
+		bool split(Depth, Score& alpha, Score beta, Score& bestScore, Move& bestMove,
+			int moveCount, MoveManager<false>&, bool inCheck, bool improving);
+		// Searches moves of given split point until none is left or a cutoff occurs
+		void searchSplitPoint(SplitPoint&);
 		// Static evaluation
 		Score evaluate();
 		// Static exchange evaluation
@@ -237,9 +449,25 @@ namespace BlendXChess
 		// Static exchange evaluation of specified capture move
 		Score SEECapture(Square, Square, Side);
 		// Quiescent search
+		template<NodeType NT>
 		Score quiescentSearch(Score, Score);
+		// Search stack entry of given ply
+		inline SearchStackEntry* stackAt(int);
+		inline const SearchStackEntry* stackAt(int) const;
 		// Update killer moves
-		void updateKillers(int, Move);
+		void updateKillers(SearchStackEntry*, Move);
+		// Update PV of given ply by given move followed by PV of the child ply
+		inline void updatePV(SearchStackEntry*, Move);
+		// Gravity-style update of a history entry bounded by given maximum absolute value
+		static inline void updateStat(int16_t&, int, int);
+		// History bonus for a move which caused cutoff at given depth
+		static inline int historyBonus(Depth);
+		// Sum of continuation history scores of given piece to given square by previous one and two moves
+		inline int contHistoryScore(Piece, Square) const;
+		// Gravity-style update of continuation histories by previous one and two moves
+		void updateContHistories(Piece, Square, int);
+		// Update capture history of given piece capturing piece of given type on given square
+		inline void updateCaptureHistory(Piece, Square, PieceType, int);
 		// Move scoring
 		void scoreMoves(MoveList&) const;
 		// (Re-)score moves and sort
@@ -255,16 +483,61 @@ namespace BlendXChess
 		TranspositionTable* transpositionTable;
 		// Thread-specific info
 		ThreadInfo* threadLocal;
+		// Innermost split point whose moves this thread searches (nullptr if none)
+		const SplitPoint* splitPoint;
 		// Ply from the searcher starting position
 		int searchPly;
-		// Previous moves information, useful for countermove heuristics
-		Move prevMoves[MAX_SEARCH_PLY];
+		// Per-thread counters of current search
+		ThreadCounters counters;
+		// Pvs calls of main thread left until the next limits check
+		int limitsCheckCountdown;
+		// Depth of current iteration
+		Depth rootDepth;
+		// Legal moves in root position (persist between iterations and aspiration re-searches)
+		RootMoves rootMoves;
+		// Search stack (per-ply search state)
+		SearchStackEntry searchStack[SEARCH_STACK_OFFSET + MAX_SEARCH_PLY + 1];
 		// History table
 		MoveScore history[SQUARE_CNT][SQUARE_CNT];
+		// Continuation history table, indexed by (piece, to) of previous move and then of current one
+		PieceToHistory continuationHistory[PIECE_CNT][SQUARE_CNT];
+		// Capture history table, indexed by moving piece, destination and captured piece type
+		int16_t captureHistory[PIECE_CNT][SQUARE_CNT][PIECETYPE_CNT];
 		// Countermoves table
 		Move countermoves[SQUARE_CNT][SQUARE_CNT];
-		// Killer moves
-		KillerList killers[MAX_SEARCH_PLY];
+	};
+
+	//============================================================
+	// Node searched by several threads in Young Brothers Wait mode
+	// Master thread (which has split it) and helpers take remaining
+	// moves from the shared move manager of the node
+	//============================================================
+
+	struct SplitPoint
+	{
+		// Whether a cutoff occurred in this split point or some of its ancestors
+		inline bool cutoffOccurred(void) const;
+		// Set by master thread before the split (read-only afterwards)
+		const SplitPoint* parent; // Split point the master searches moves of (nullptr if none)
+		Position pos;
+		int ply; // Search ply of the node
+		Searcher::SearchStackEntry stack[3]; // Entries of the node and two previous plies
+		NodeType nodeType;
+		Depth depth;
+		Score beta;
+		bool inCheck, improving;
+		MoveManager<false>* moveManager;
+		// Shared by threads and guarded by mutex
+		std::mutex mutex;
+		std::condition_variable helpersDone;
+		Score alpha, bestScore;
+		Move bestMove;
+		int moveCount;
+		int helperCount; // Helpers which haven't finished yet
+		int pvLength; // Zero if alpha wasn't raised since the split
+		Move pv[MAX_SEARCH_PLY];
+		// Set when some thread gets a beta-cutoff (read without lock)
+		std::atomic_bool cutoff;
 	};
 
 	//============================================================
@@ -274,9 +547,20 @@ namespace BlendXChess
 	struct ThreadInfo
 	{
 		std::thread handle;
-		Searcher searcher;
+		std::unique_ptr<Searcher> searcher; // Allocated by the thread itself (so it's on the thread's NUMA node)
 		SearchResults results;
 		int ID; // 0 for main thread
+		// Parking of the pool thread between searches
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		bool searching = false; // Guarded by mutex
+		bool terminate = false; // Guarded by mutex
+		SplitPoint* splitPoint = nullptr; // Split point the helper is assigned to (set under both mutexes)
+		bool idle = false; // Whether helper waits for a split point (guarded by shared split mutex)
+		Depth startDepth = 1; // Depth the helper starts iterative deepening from
+		// Set when thread count is reduced during search. Lazy SMP helper abandons its search then,
+		// Young Brothers Wait one finishes current split point, and then they park
+		std::atomic_bool retire = false;
 	};
 
 	//============================================================
@@ -328,19 +612,6 @@ namespace BlendXChess
 		option = value;
 	}
 
-	inline void MultiSearcher::setThreadCount(unsigned int threadCount)
-	{
-		if (inSearch)
-			throw std::runtime_error("Error: Can't change thread count while in search");
-		clampSetter(options.threadCount, threadCount,
-			THREAD_COUNT_MIN, "Warning: Thread count must be positive and is set to 1",
-			getMaxThreadCount(), "Warning: Thread count is too big and is set to "
-			+ std::to_string(getMaxThreadCount()));
-		// Update size of dependant structures
-		threads.resize(threadCount);
-		shared.rootSearchStates.resize(threadCount);
-	}
-
 	inline void MultiSearcher::setTimeLimit(unsigned int timeLimit)
 	{
 		if (inSearch)
@@ -362,11 +633,39 @@ namespace BlendXChess
 			+ std::to_string(SEARCH_DEPTH_MAX));
 	}
 
+	inline void MultiSearcher::setMoveOverhead(TimeMs moveOverhead)
+	{
+		if (inSearch)
+			throw std::runtime_error("Error: Can't change move overhead while in search");
+		clampSetter(options.moveOverhead, moveOverhead,
+			MOVE_OVERHEAD_MIN, "Warning: Move overhead can't be negative and is set to 0",
+			MOVE_OVERHEAD_MAX, "Warning: Move overhead must be maximum "
+			+ std::to_string(MOVE_OVERHEAD_MAX) + "ms and is set to this");
+	}
+
+	inline void MultiSearcher::setSMPMode(SMPMode smpMode)
+	{
+		if (inSearch)
+			throw std::runtime_error("Error: Can't change SMP mode while in search");
+		options.smpMode = smpMode;
+	}
+
+	inline void MultiSearcher::setSMPDepthSkipping(bool smpDepthSkipping)
+	{
+		if (inSearch)
+			throw std::runtime_error("Error: Can't change SMP depth skipping while in search");
+		options.smpDepthSkipping = smpDepthSkipping;
+	}
+
 	inline void MultiSearcher::setOptions(const SearchOptions& opt)
 	{
 		setThreadCount(opt.threadCount);
 		setDepth(opt.depth);
 		setTimeLimit(opt.timeLimit);
+		setMoveOverhead(opt.moveOverhead);
+		setSMPMode(opt.smpMode);
+		setSMPDepthSkipping(opt.smpDepthSkipping);
+		setNumaPinning(opt.numaPinning);
 	}
 
 	inline bool Searcher::isMainThread(void) const
@@ -386,6 +685,137 @@ namespace BlendXChess
 			score < SCORE_LOSE_MAX ? score + searchPly : score;
 	}
 
+	inline void Searcher::updateStat(int16_t& entry, int bonus, int maxValue)
+	{
+		entry += bonus - entry * abs(bonus) / maxValue;
+	}
+
+	inline int Searcher::historyBonus(Depth depth)
+	{
+		return std::min(32 * depth * depth, 1600);
+	}
+
+	inline Searcher::SearchStackEntry* Searcher::stackAt(int ply)
+	{
+		assert(-SEARCH_STACK_OFFSET <= ply && ply <= MAX_SEARCH_PLY);
+		return searchStack + SEARCH_STACK_OFFSET + ply;
+	}
+
+	inline const Searcher::SearchStackEntry* Searcher::stackAt(int ply) const
+	{
+		assert(-SEARCH_STACK_OFFSET <= ply && ply <= MAX_SEARCH_PLY);
+		return searchStack + SEARCH_STACK_OFFSET + ply;
+	}
+
+	inline void Searcher::updatePV(SearchStackEntry* ss, Move move)
+	{
+		const SearchStackEntry* const child = ss + 1;
+		ss->pv[0] = move;
+		std::copy(child->pv, child->pv + child->pvLength, ss->pv + 1);
+		ss->pvLength = child->pvLength + 1;
+	}
+
+	inline int Searcher::contHistoryScore(Piece pc, Square to) const
+	{
+		// contHistory is nullptr for entries before the root
+		const SearchStackEntry* const ss = stackAt(searchPly);
+		int score = 0;
+		if ((ss - 1)->contHistory)
+			score += (*(ss - 1)->contHistory)[pc][to];
+		if ((ss - 2)->contHistory)
+			score += (*(ss - 2)->contHistory)[pc][to];
+		return score;
+	}
+
+	inline void Searcher::updateCaptureHistory(Piece pc, Square to, PieceType captured, int bonus)
+	{
+		updateStat(captureHistory[pc][to][captured], bonus, CAPTURE_HISTORY_MAX);
+	}
+
+	inline int Searcher::threadsSearching(Move move) const
+	{
+		return shared->rootMoveSearchers[move.raw()].load(std::memory_order_relaxed);
+	}
+
+	inline Key Searcher::searchingKey(Move move) const
+	{
+		return pos.info.keyZobrist ^ (Key(move.raw() + 1) * 0x9E3779B97F4A7C15);
+	}
+
+	inline bool Searcher::isSearching(Key key) const
+	{
+		return shared->searchingMoves[key & SEARCHING_TABLE_MASK].load(std::memory_order_relaxed) == key;
+	}
+
+	inline void Searcher::markSearching(Key key)
+	{
+		shared->searchingMoves[key & SEARCHING_TABLE_MASK].store(key, std::memory_order_relaxed);
+	}
+
+	inline void Searcher::unmarkSearching(Key key)
+	{
+		// Slot could be taken by another pair since, then it's left as is
+		shared->searchingMoves[key & SEARCHING_TABLE_MASK].compare_exchange_strong(key, 0, std::memory_order_relaxed);
+	}
+
+	inline bool SplitPoint::cutoffOccurred(void) const
+	{
+		for (const SplitPoint* sp = this; sp; sp = sp->parent)
+			if (sp->cutoff.load(std::memory_order_relaxed))
+				return true;
+		return false;
+	}
+
+	inline bool Searcher::searchAborted(void) const
+	{
+		return shared->stopSearch || (splitPoint && splitPoint->cutoffOccurred())
+			|| (options->smpMode == SMPMode::LAZY && threadLocal->retire.load(std::memory_order_relaxed));
+	}
+
+	inline TimeMs Searcher::elapsedTime(void) const
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::high_resolution_clock::now() - shared->startTime).count()
+			- shared->ponderTime.load(std::memory_order_relaxed);
+	}
+
+	inline const RootMoves& Searcher::getRootMoves(void) const noexcept
+	{
+		return rootMoves;
+	}
+
+	inline uint64_t Searcher::getNodes(void) const noexcept
+	{
+		return counters.nodes.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t Searcher::getTTHits(void) const noexcept
+	{
+		return counters.ttHits.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t SharedInfo::totalNodes(void) const
+	{
+		uint64_t nodes = 0;
+		for (const ThreadInfo& threadInfo : *threads)
+			nodes += threadInfo.searcher->getNodes();
+		return nodes;
+	}
+
+	inline SearchStats SharedInfo::collectStats(void)
+	{
+		if constexpr (SEARCH_NODES_COUNT_ENABLED)
+			stats.visitedNodes = totalNodes();
+		if constexpr (TT_HITS_COUNT_ENABLED)
+		{
+			uint64_t ttHits = 0;
+			for (const ThreadInfo& threadInfo : *threads)
+				ttHits += threadInfo.searcher->getTTHits();
+			stats.ttHits = ttHits;
+		}
+		return stats;
+	}
+
 	inline void Searcher::sortMoves(MoveList& ml) const
 	{
 		// ml.reset();
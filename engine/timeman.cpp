@@ -0,0 +1,86 @@
+//============================================================
+// timeman.cpp
+// BlendXChess
+//============================================================
+
+#include "timeman.h"
+#include <algorithm>
+
+namespace BlendXChess
+{
+
+	// Assumed count of moves to the end of the game (or to the next time control)
+	constexpr int MOVES_TO_GO_DEFAULT = 30;
+	constexpr int MOVES_TO_GO_MAX = 50;
+	// Time given to the move when the clock is (almost) out
+	constexpr TimeMs CLOCK_TIME_MIN = 10; // ms
+	// Maximum time is at most this many times bigger than optimum
+	constexpr int MAX_TO_OPTIMUM_RATIO = 5;
+	// Part of the clock which may be spent on a single move
+	constexpr double MAX_CLOCK_SHARE = 0.8;
+	// Weight of recent best move changes in extending the time
+	constexpr double BEST_MOVE_INSTABILITY_WEIGHT = 0.6;
+	// Score drop (in centipawns) which doubles the time
+	constexpr int SCORE_DROP_DOUBLING = 100;
+	// Best move is considered easy if this share of nodes was spent on its subtree
+	constexpr double EASY_MOVE_NODE_SHARE = 0.85;
+	constexpr double EASY_MOVE_SCALE = 0.4;
+	// Each iteration takes longer than all previous ones together, so the next one
+	// is not started if this part of the time budget is already used
+	constexpr double NEXT_ITERATION_TIME_SHARE = 0.6;
+
+	//============================================================
+	// Computes time for the move of given side
+	//============================================================
+	void TimeManager::initialize(const SearchLimits& limits, Color us,
+		TimeMs defaultMoveTime, TimeMs moveOverhead)
+	{
+		timeLimited = true;
+		clockManaged = false;
+		if (limits.moveTime)
+			optimum = maximum = std::max<TimeMs>(limits.moveTime - moveOverhead, 1);
+		else if (limits.timeGiven[us])
+		{
+			clockManaged = true;
+			const TimeMs time = limits.time[us], inc = limits.inc[us];
+			const int movesToGo = limits.movesToGo ? std::min(limits.movesToGo, MOVES_TO_GO_MAX)
+				: MOVES_TO_GO_DEFAULT;
+			// Time available for the remaining moves, with overhead reserved for each of them
+			const TimeMs timeLeft = std::max<TimeMs>(time + inc * (movesToGo - 1)
+				- moveOverhead * (movesToGo + 1), 1);
+			const TimeMs clockCap = std::max<TimeMs>(TimeMs(time * MAX_CLOCK_SHARE) - moveOverhead,
+				CLOCK_TIME_MIN);
+			optimum = std::clamp<TimeMs>(timeLeft / movesToGo, CLOCK_TIME_MIN, clockCap);
+			maximum = std::min(optimum * MAX_TO_OPTIMUM_RATIO, clockCap);
+		}
+		else if (!limits.empty() && !limits.timeGiven[opposite(us)])
+		{
+			// Search is limited only by depth or nodes (or is infinite)
+			timeLimited = false;
+			optimum = maximum = 0;
+		}
+		else // No limit or only opponent's clock is given
+			optimum = maximum = defaultMoveTime;
+	}
+
+	//============================================================
+	// Whether the next iteration should not be started
+	//============================================================
+	bool TimeManager::stopIteration(TimeMs elapsed, double bestMoveChanges, int scoreDrop,
+		double bestMoveNodeShare, int rootMoveCount) const
+	{
+		if (!clockManaged)
+			return false;
+		// There is nothing to think about with a single legal move
+		if (rootMoveCount == 1)
+			return true;
+		double budget = optimum;
+		// Spend more time if best move is unstable or the score drops
+		budget *= 1.0 + BEST_MOVE_INSTABILITY_WEIGHT * bestMoveChanges;
+		budget *= 1.0 + double(std::clamp(scoreDrop, 0, SCORE_DROP_DOUBLING)) / SCORE_DROP_DOUBLING;
+		// And less if almost all effort goes to the best move
+		if (bestMoveNodeShare >= EASY_MOVE_NODE_SHARE)
+			budget *= EASY_MOVE_SCALE;
+		return elapsed >= std::min<double>(budget, maximum) * NEXT_ITERATION_TIME_SHARE;
+	}
+}
@@ -0,0 +1,93 @@
+//============================================================
+// timeman.h
+// BlendXChess
+//============================================================
+
+#pragma once
+#ifndef _TIMEMAN_H
+#define _TIMEMAN_H
+#include "basic_types.h"
+
+namespace BlendXChess
+{
+
+	typedef int64_t TimeMs;
+
+	constexpr TimeMs MOVE_OVERHEAD_DEFAULT = 30; // ms
+	constexpr TimeMs MOVE_OVERHEAD_MIN = 0; // ms
+	constexpr TimeMs MOVE_OVERHEAD_MAX = 5000; // ms
+
+	//============================================================
+	// Limits of a single search (mostly given by UCI 'go' command)
+	// Zero value of a field means that the limit is not given
+	// (except for clock time, which may legitimately be zero)
+	//============================================================
+
+	struct SearchLimits
+	{
+		bool timeGiven[COLOR_CNT] = {}; // Whether clock time of the side is given
+		TimeMs time[COLOR_CNT] = {}; // Time left on the clock
+		TimeMs inc[COLOR_CNT] = {}; // Increment per move
+		int movesToGo = 0; // Moves to the next time control (0 for sudden death)
+		TimeMs moveTime = 0; // Exact time to search
+		Depth depth = DEPTH_ZERO;
+		uint64_t nodes = 0;
+		bool infinite = false; // Search until stopped (even if it's finished earlier)
+		bool ponder = false; // Time isn't counted until ponderhit (and search isn't finished before it)
+		// Whether no limit is given (search options are used then)
+		inline bool empty(void) const;
+	};
+
+	//============================================================
+	// Class for allocating time for a single search
+	//============================================================
+
+	class TimeManager
+	{
+	public:
+		// Computes time for the move of given side (default move time is used when no limit is given)
+		void initialize(const SearchLimits&, Color, TimeMs defaultMoveTime, TimeMs moveOverhead);
+		// Whether search is limited by time
+		inline bool isTimeLimited(void) const noexcept;
+		// Time that should normally be spent on the move
+		inline TimeMs getOptimum(void) const noexcept;
+		// Time after which search is stopped unconditionally
+		inline TimeMs getMaximum(void) const noexcept;
+		// Whether the next iteration should not be started, given elapsed time, recent best move
+		// changes, score drop since previous iteration, share of nodes spent on the best move
+		// and count of legal root moves (used only when search is driven by the clock)
+		bool stopIteration(TimeMs elapsed, double bestMoveChanges, int scoreDrop,
+			double bestMoveNodeShare, int rootMoveCount) const;
+	private:
+		bool timeLimited; // Whether search is stopped when maximum time is exceeded
+		bool clockManaged; // Whether time is allocated from the clock (so it may vary)
+		TimeMs optimum;
+		TimeMs maximum;
+	};
+
+	//============================================================
+	// Implementation of inline functions
+	//============================================================
+
+	inline bool SearchLimits::empty(void) const
+	{
+		return !timeGiven[WHITE] && !timeGiven[BLACK] && !moveTime && !depth && !nodes && !infinite;
+	}
+
+	inline bool TimeManager::isTimeLimited(void) const noexcept
+	{
+		return timeLimited;
+	}
+
+	inline TimeMs TimeManager::getOptimum(void) const noexcept
+	{
+		return optimum;
+	}
+
+	inline TimeMs TimeManager::getMaximum(void) const noexcept
+	{
+		return maximum;
+	}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #define _TRANSTABLE_H
 #include "basic_types.h"
 #include <mutex>
+#include <cstring>
 
 namespace BlendXChess
 {